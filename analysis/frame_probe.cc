@@ -0,0 +1,219 @@
+#include "frame_probe.h"
+#include "luma_kernels.h"
+
+#include <cinttypes>
+
+namespace {
+
+// a pixel at or below this luma counts as black, and a frame is
+// black when BLACK_RATIO of its pixels are
+const int BLACK_PIXEL_MAX {32};
+const double BLACK_RATIO {0.98};
+// mean absolute luma difference to the previous frame below which
+// the frame is considered frozen
+const double FROZEN_MAFD {0.5};
+
+}
+
+FrameProbe::~FrameProbe() {
+    stop();
+}
+
+bool FrameProbe::start(const std::string& path, const ThreadPolicy& policy,
+    AVRational time_base, size_t max_queue) {
+    stop();
+
+    out_ = fopen(path.c_str(), "a");
+    if (out_ == nullptr) {
+        fprintf(stderr, "Error: Failed to open analysis output [%s].\n", path.c_str());
+        return false;
+    }
+
+    path_ = path;
+    policy_ = policy;
+    time_base_ = time_base;
+    max_queue_ = max_queue > 0 ? max_queue : 1;
+    stopping_ = false;
+    submitted_ = dropped_ = 0;
+    prev_mafd_ = 0.0;
+    warned_format_ = false;
+
+    if (pthread_create(&tid_, nullptr, frame_probe_thread, (void *) this) != 0) {
+        fprintf(stderr, "Error: Failed to start analysis thread.\n");
+        fclose(out_);
+        out_ = nullptr;
+        return false;
+    }
+
+    running_ = true;
+    printf("Analyzing frames into [%s] (%s kernels).\n", path.c_str(), luma_kernels_isa());
+    return true;
+}
+
+void FrameProbe::stop() {
+    if (!running_) return;
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mtx_);
+        stopping_ = true;
+    }
+    queue_cv_.notify_one();
+    pthread_join(tid_, nullptr);
+    running_ = false;
+
+    if (prev_ != nullptr) av_frame_free(&prev_);
+    fclose(out_);
+    out_ = nullptr;
+
+    if (dropped_ > 0) {
+        printf("Analysis skipped %" PRIu64 " of %" PRIu64 " frames to keep up with playback.\n",
+            dropped_, submitted_);
+    }
+}
+
+void FrameProbe::submit(const AVFrame *frame) {
+    if (!running_) return;
+
+    std::unique_lock<std::mutex> lock(queue_mtx_);
+    uint64_t number = submitted_++;
+    if (queue_.size() >= max_queue_) {
+        ++dropped_;
+        return;
+    }
+
+    AVFrame *ref = av_frame_clone(frame);
+    if (ref == nullptr) {
+        ++dropped_;
+        return;
+    }
+
+    queue_.push_back(Item{ref, number, dropped_});
+    lock.unlock();
+    queue_cv_.notify_one();
+}
+
+void * frame_probe_thread (void* params) {
+    FrameProbe *probe = (FrameProbe *) params;
+    apply_thread_policy(ROLE_ANALYSIS, probe->policy_);
+
+    while (true) {
+        FrameProbe::Item item;
+        {
+            std::unique_lock<std::mutex> lock(probe->queue_mtx_);
+            probe->queue_cv_.wait(lock, [probe] {
+                return probe->stopping_ || !probe->queue_.empty();
+            });
+            if (probe->queue_.empty()) break;
+
+            item = probe->queue_.front();
+            probe->queue_.pop_front();
+        }
+
+        probe->analyze(item);
+    }
+
+    fflush(probe->out_);
+    return (void*) nullptr;
+}
+
+void FrameProbe::analyze(const Item& item) {
+    AVFrame *frame = item.frame;
+
+    // the luma plane is plane 0 of the yuv and gray formats, in bytes
+    // up to 8 bits and in native endian words above. Formats like p010
+    // keep their samples in the high bits, which the shift accounts for
+    auto desc = av_pix_fmt_desc_get((AVPixelFormat) frame->format);
+    const int bits = desc == nullptr ? 0 : desc->comp[0].depth + desc->comp[0].shift;
+    const bool deep = bits > 8;
+    if (desc == nullptr || (desc->flags & AV_PIX_FMT_FLAG_RGB)
+        || (desc->flags & AV_PIX_FMT_FLAG_HWACCEL)
+        || (deep ? bits > 16 || (desc->flags & AV_PIX_FMT_FLAG_BE) != 0
+            : desc->comp[0].depth != 8)) {
+        if (!warned_format_) {
+            fprintf(stderr, "Warning: Analysis of pixel format [%s] is not supported.\n",
+                desc == nullptr ? "null" : desc->name);
+            warned_format_ = true;
+        }
+        av_frame_free(&frame);
+        return;
+    }
+
+    const int width {frame->width};
+    const int height {frame->height};
+    const double pixels = (double) width * height;
+
+    // deep samples are binned on their top 8 bits, so the histogram and
+    // the stats below stay on the 8-bit scale whatever the source depth
+    uint32_t hist[256];
+    if (deep) {
+        luma_histogram16((const uint16_t *) frame->data[0], frame->linesize[0],
+            width, height, bits, hist);
+    } else {
+        luma_histogram(frame->data[0], frame->linesize[0], width, height, hist);
+    }
+
+    uint64_t sum {0}, dark {0};
+    int min {-1}, max {0};
+    for (int i = 0; i < 256; ++i) {
+        if (hist[i] == 0) continue;
+        sum += (uint64_t) i * hist[i];
+        if (min < 0) min = i;
+        max = i;
+        if (i <= BLACK_PIXEL_MAX) dark += hist[i];
+    }
+    const double mean = pixels > 0 ? sum / pixels : 0.0;
+    const bool black = pixels > 0 && dark >= BLACK_RATIO * pixels;
+
+    // compare against the last analyzed frame, which is not the
+    // previous frame if some were dropped
+    bool has_ref = prev_ != nullptr && prev_->format == frame->format
+        && prev_->width == width && prev_->height == height;
+    uint64_t sad {0};
+    double mafd {0.0}, scene {0.0};
+    if (has_ref) {
+        if (deep) {
+            sad = luma_sad16((const uint16_t *) frame->data[0], frame->linesize[0],
+                (const uint16_t *) prev_->data[0], prev_->linesize[0], width, height);
+        } else {
+            sad = luma_sad(frame->data[0], frame->linesize[0],
+                prev_->data[0], prev_->linesize[0], width, height);
+        }
+        // sad is in source units, mafd is scaled to 8 bits like scdet
+        // does so the thresholds hold for any depth
+        mafd = sad / pixels / (double) (1 << (bits - 8));
+        // same score as ffmpeg's scdet filter, 0 to 100
+        double diff = mafd - prev_mafd_;
+        if (diff < 0) diff = -diff;
+        scene = (mafd < diff ? mafd : diff) * 100.0 / 256.0;
+        if (scene > 100.0) scene = 100.0;
+    }
+    const bool frozen = has_ref && mafd < FROZEN_MAFD;
+
+    fprintf(out_, "{\"frame\":%" PRIu64 ",", item.number);
+    if (frame->best_effort_timestamp == AV_NOPTS_VALUE) {
+        fprintf(out_, "\"pts\":null,\"time\":null,");
+    } else {
+        fprintf(out_, "\"pts\":%" PRId64 ",\"time\":%.6f,", frame->best_effort_timestamp,
+            frame->best_effort_timestamp * av_q2d(time_base_));
+    }
+    fprintf(out_, "\"width\":%d,\"height\":%d,\"depth\":%d,\"mean\":%.3f,\"min\":%d,"
+        "\"max\":%d,\"black\":%s,\"frozen\":%s,",
+        width, height, bits, mean, min < 0 ? 0 : min, max,
+        black ? "true" : "false", frozen ? "true" : "false");
+    if (has_ref) {
+        fprintf(out_, "\"ref\":%" PRIu64 ",\"sad\":%" PRIu64 ",\"mafd\":%.4f,\"scene\":%.4f,",
+            prev_number_, sad, mafd, scene);
+    } else {
+        fprintf(out_, "\"ref\":null,\"sad\":null,\"mafd\":null,\"scene\":null,");
+    }
+    fprintf(out_, "\"dropped\":%" PRIu64 ",\"hist\":[", item.dropped);
+    for (int i = 0; i < 256; ++i) {
+        fprintf(out_, i == 0 ? "%u" : ",%u", hist[i]);
+    }
+    fprintf(out_, "]}\n");
+
+    if (prev_ != nullptr) av_frame_free(&prev_);
+    prev_ = frame;
+    prev_number_ = item.number;
+    prev_mafd_ = mafd;
+}
@@ -0,0 +1,108 @@
+#ifndef _FRAME_PROBE_H_
+#define _FRAME_PROBE_H_
+
+#include <string>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdint>
+#include <pthread.h>
+
+#include <ffmpeg_extern.h>
+#include "../player/thread_policy.h"
+
+/**
+ * @def
+ * Default number of frames the probe queues before dropping.
+ * */
+#define FRAME_PROBE_QUEUE 4
+
+/**
+ * @def
+ * Signal metrics of decoded frames, computed on the luma plane before
+ * conversion: histogram, mean/min/max, black and frozen frame flags and
+ * a scene change score. Results are appended to a file as one JSON
+ * object per line.
+ *
+ * Sources deeper than 8 bits are analyzed on the 8-bit scale: the
+ * histogram bins their top 8 bits and mafd is divided by 2^(depth - 8),
+ * while sad stays in source units. "depth" gives the source bit depth.
+ *
+ * Frames are analyzed on a worker thread. submit only takes a
+ * reference to the frame and drops it when the worker is behind, so
+ * the probe never holds up playback.
+ * */
+class FrameProbe {
+
+public:
+    FrameProbe() = default;
+    FrameProbe(const FrameProbe &p) = delete;
+    ~FrameProbe();
+
+    void operator=(const FrameProbe &p) = delete;
+
+    /**
+     * @def
+     * Open [path] for appending and start the worker for a stream with
+     * the given [time_base]. At most [max_queue] frames wait for the
+     * worker.
+     * */
+    bool start(const std::string& path, const ThreadPolicy& policy,
+        AVRational time_base, size_t max_queue = FRAME_PROBE_QUEUE);
+
+    /**
+     * @def
+     * Analyze the frames still queued, then join the worker and close
+     * the output.
+     * */
+    void stop();
+
+    bool running() const { return running_; }
+    const std::string& path() const { return path_; }
+
+    /**
+     * @def
+     * Queue [frame] for analysis without copying its planes.
+     * */
+    void submit(const AVFrame *frame);
+
+private:
+    struct Item {
+        AVFrame *frame;
+        uint64_t number;
+        uint64_t dropped;
+    };
+
+    std::string path_;
+    FILE *out_ = nullptr;
+    pthread_t tid_;
+    bool running_ = false;
+    ThreadPolicy policy_;
+    AVRational time_base_ = {0, 1};
+
+    std::mutex queue_mtx_;
+    std::condition_variable queue_cv_;
+    std::deque<Item> queue_;
+    bool stopping_ = false;
+    size_t max_queue_ = FRAME_PROBE_QUEUE;
+    uint64_t submitted_ = 0;
+    uint64_t dropped_ = 0;
+
+    /**
+     * Worker state. prev_ is the last analyzed frame, the reference
+     * for the frozen frame and scene change metrics.
+     * */
+    AVFrame *prev_ = nullptr;
+    uint64_t prev_number_ = 0;
+    double prev_mafd_ = 0.0;
+    bool warned_format_ = false;
+
+    void analyze(const Item& item);
+
+    friend void * frame_probe_thread (void* params);
+};
+
+void * frame_probe_thread (void* params);
+
+#endif
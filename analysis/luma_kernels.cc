@@ -0,0 +1,177 @@
+#include "luma_kernels.h"
+
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+void luma_histogram (const uint8_t *plane, int linesize, int width, int height,
+    uint32_t hist[256]) {
+    // histogramming doesn't map to simd, instead spread the counts over
+    // four tables so runs of equal pixels (common in video) don't stall
+    // on the store of the previous increment to the same bin
+    uint32_t sub[4][256];
+    memset(sub, 0, sizeof(sub));
+
+    for (int y = 0; y < height; ++y) {
+        const uint8_t *row = plane + (long) y * linesize;
+        int x {0};
+        for (; x + 4 <= width; x += 4) {
+            ++sub[0][row[x]];
+            ++sub[1][row[x+1]];
+            ++sub[2][row[x+2]];
+            ++sub[3][row[x+3]];
+        }
+        for (; x < width; ++x) ++sub[0][row[x]];
+    }
+
+    for (int i = 0; i < 256; ++i) {
+        hist[i] = sub[0][i] + sub[1][i] + sub[2][i] + sub[3][i];
+    }
+}
+
+uint64_t luma_sad (const uint8_t *a, int linesize_a,
+    const uint8_t *b, int linesize_b, int width, int height) {
+    uint64_t sad {0};
+
+    for (int y = 0; y < height; ++y) {
+        const uint8_t *row_a = a + (long) y * linesize_a;
+        const uint8_t *row_b = b + (long) y * linesize_b;
+        int x {0};
+
+#if defined(__AVX2__)
+        __m256i acc = _mm256_setzero_si256();
+        for (; x + 32 <= width; x += 32) {
+            __m256i va = _mm256_loadu_si256((const __m256i *) (row_a + x));
+            __m256i vb = _mm256_loadu_si256((const __m256i *) (row_b + x));
+            acc = _mm256_add_epi64(acc, _mm256_sad_epu8(va, vb));
+        }
+        uint64_t lanes[4];
+        _mm256_storeu_si256((__m256i *) lanes, acc);
+        sad += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(__SSE2__)
+        __m128i acc = _mm_setzero_si128();
+        for (; x + 16 <= width; x += 16) {
+            __m128i va = _mm_loadu_si128((const __m128i *) (row_a + x));
+            __m128i vb = _mm_loadu_si128((const __m128i *) (row_b + x));
+            acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+        }
+        uint64_t lanes[2];
+        _mm_storeu_si128((__m128i *) lanes, acc);
+        sad += lanes[0] + lanes[1];
+#elif defined(__ARM_NEON)
+        uint32x4_t acc = vdupq_n_u32(0);
+        for (; x + 16 <= width; x += 16) {
+            uint8x16_t diff = vabdq_u8(vld1q_u8(row_a + x), vld1q_u8(row_b + x));
+            acc = vpadalq_u16(acc, vpaddlq_u8(diff));
+        }
+        sad += vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1)
+            + vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+#endif
+
+        for (; x < width; ++x) {
+            int diff = (int) row_a[x] - (int) row_b[x];
+            sad += diff < 0 ? -diff : diff;
+        }
+    }
+
+    return sad;
+}
+
+void luma_histogram16 (const uint16_t *plane, int linesize, int width, int height,
+    int bits, uint32_t hist[256]) {
+    const int shift = bits > 8 ? bits - 8 : 0;
+    uint32_t sub[4][256];
+    memset(sub, 0, sizeof(sub));
+
+    for (int y = 0; y < height; ++y) {
+        const uint16_t *row = (const uint16_t *) ((const uint8_t *) plane + (long) y * linesize);
+        int x {0};
+        // the mask keeps samples above [bits] inside the table
+        for (; x + 4 <= width; x += 4) {
+            ++sub[0][(row[x] >> shift) & 0xff];
+            ++sub[1][(row[x+1] >> shift) & 0xff];
+            ++sub[2][(row[x+2] >> shift) & 0xff];
+            ++sub[3][(row[x+3] >> shift) & 0xff];
+        }
+        for (; x < width; ++x) ++sub[0][(row[x] >> shift) & 0xff];
+    }
+
+    for (int i = 0; i < 256; ++i) {
+        hist[i] = sub[0][i] + sub[1][i] + sub[2][i] + sub[3][i];
+    }
+}
+
+uint64_t luma_sad16 (const uint16_t *a, int linesize_a,
+    const uint16_t *b, int linesize_b, int width, int height) {
+    uint64_t sad {0};
+
+    for (int y = 0; y < height; ++y) {
+        const uint16_t *row_a = (const uint16_t *) ((const uint8_t *) a + (long) y * linesize_a);
+        const uint16_t *row_b = (const uint16_t *) ((const uint8_t *) b + (long) y * linesize_b);
+        int x {0};
+
+        // there is no 16-bit psadbw: |a - b| is the or of the two
+        // saturating differences, widened into 32-bit lanes. A row is
+        // summed in 32 bits, which holds for rows below 2^18 samples.
+#if defined(__AVX2__)
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i acc = _mm256_setzero_si256();
+        for (; x + 16 <= width; x += 16) {
+            __m256i va = _mm256_loadu_si256((const __m256i *) (row_a + x));
+            __m256i vb = _mm256_loadu_si256((const __m256i *) (row_b + x));
+            __m256i diff = _mm256_or_si256(_mm256_subs_epu16(va, vb), _mm256_subs_epu16(vb, va));
+            acc = _mm256_add_epi32(acc, _mm256_unpacklo_epi16(diff, zero));
+            acc = _mm256_add_epi32(acc, _mm256_unpackhi_epi16(diff, zero));
+        }
+        uint32_t lanes[8];
+        _mm256_storeu_si256((__m256i *) lanes, acc);
+        for (int i = 0; i < 8; ++i) sad += lanes[i];
+#elif defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        __m128i acc = _mm_setzero_si128();
+        for (; x + 8 <= width; x += 8) {
+            __m128i va = _mm_loadu_si128((const __m128i *) (row_a + x));
+            __m128i vb = _mm_loadu_si128((const __m128i *) (row_b + x));
+            __m128i diff = _mm_or_si128(_mm_subs_epu16(va, vb), _mm_subs_epu16(vb, va));
+            acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(diff, zero));
+            acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(diff, zero));
+        }
+        uint32_t lanes[4];
+        _mm_storeu_si128((__m128i *) lanes, acc);
+        sad += (uint64_t) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(__ARM_NEON)
+        uint32x4_t acc = vdupq_n_u32(0);
+        for (; x + 8 <= width; x += 8) {
+            uint16x8_t diff = vabdq_u16(vld1q_u16(row_a + x), vld1q_u16(row_b + x));
+            acc = vpadalq_u16(acc, diff);
+        }
+        sad += (uint64_t) vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1)
+            + vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+#endif
+
+        for (; x < width; ++x) {
+            int diff = (int) row_a[x] - (int) row_b[x];
+            sad += diff < 0 ? -diff : diff;
+        }
+    }
+
+    return sad;
+}
+
+const char * luma_kernels_isa () {
+#if defined(__AVX2__)
+    return "avx2";
+#elif defined(__SSE2__)
+    return "sse2";
+#elif defined(__ARM_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
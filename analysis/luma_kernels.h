@@ -0,0 +1,50 @@
+#ifndef _LUMA_KERNELS_H_
+#define _LUMA_KERNELS_H_
+
+#include <cstdint>
+
+/**
+ * Kernels over an 8-bit luma plane, and 16-bit variants for deeper
+ * sources. [linesize] is the distance in bytes between rows and may be
+ * larger than [width] (times 2 for the 16-bit variants).
+ * */
+
+/**
+ * @def
+ * Count the pixels of every luma value into [hist], which is
+ * overwritten.
+ * */
+void luma_histogram (const uint8_t *plane, int linesize, int width, int height,
+    uint32_t hist[256]);
+
+/**
+ * @def
+ * Sum of absolute differences between two planes of the same size.
+ * */
+uint64_t luma_sad (const uint8_t *a, int linesize_a,
+    const uint8_t *b, int linesize_b, int width, int height);
+
+/**
+ * @def
+ * luma_histogram for samples of [bits] significant bits (9 to 16)
+ * stored in 16-bit words. Values are binned into 256 bins by
+ * dropping the low [bits] - 8 bits.
+ * */
+void luma_histogram16 (const uint16_t *plane, int linesize, int width, int height,
+    int bits, uint32_t hist[256]);
+
+/**
+ * @def
+ * luma_sad for 16-bit samples. The result is in sample units, divide
+ * by 2^(bits - 8) to compare it with 8-bit planes.
+ * */
+uint64_t luma_sad16 (const uint16_t *a, int linesize_a,
+    const uint16_t *b, int linesize_b, int width, int height);
+
+/**
+ * @def
+ * Name of the instruction set luma_sad was built for.
+ * */
+const char * luma_kernels_isa ();
+
+#endif
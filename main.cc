@@ -1,6 +1,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <cstdio>
+#include <climits>
 #include <signal.h>
 #include <string>
 #include <iostream>
@@ -16,6 +17,11 @@
 
 void handle_signal(int signal);
 void help_prompt();
+void thread_command(Player& player, const std::vector<std::string>& tokens);
+void export_command(Player& player, const std::vector<std::string>& tokens);
+void analyze_command(Player& player, const std::vector<std::string>& tokens);
+void loop_command(Player& player, const std::vector<std::string>& tokens);
+void memory_command(Player& player, const std::vector<std::string>& tokens);
 std::vector<std::string> tokenize(const std::string& line);
 
 int main_(int argc, char **argv) {
@@ -61,10 +67,22 @@ int main (int argc, char **argv) {
             } else {
                 player.load_file(tokens[1]);
             }
+        } else if (tokens[0].compare("stop") == 0) {
+            player.stop();
+        } else if (tokens[0].compare("export") == 0) {
+            export_command(player, tokens);
+        } else if (tokens[0].compare("analyze") == 0) {
+            analyze_command(player, tokens);
+        } else if (tokens[0].compare("loop") == 0) {
+            loop_command(player, tokens);
+        } else if (tokens[0].compare("memory") == 0) {
+            memory_command(player, tokens);
         } else if (tokens[0].compare("pause") == 0) {
             player.pause();
         } else if (tokens[0].compare("resume") == 0) {
             player.resume();
+        } else if (tokens[0].compare("thread") == 0) {
+            thread_command(player, tokens);
         } else if (tokens[0].compare("exit") == 0) {
             printf("Terminating Program.\n");
             break;
@@ -84,18 +102,206 @@ void handle_signal(int signal) {
         printf("Terminating program.\n");
     }
 
+    // ~Player doesn't run on exit(), an exported ring would stay
+    // in /dev/shm and hold its memory
+    shm_sink_close_all();
+
     exit(EXIT_SUCCESS);
 }
 
 void help_prompt() {
     printf("-- [Help] --\n");
     printf("\tload <path_to_file>\tLoad a file into the video player.\n");
+    printf("\tstop\t\tStop the loaded video and release it.\n");
     printf("\tpause\tPause the video, if there is a video loaded.\n");
     printf("\tresume\tUnpause the video, if there is a video loaded.\n");
+    printf("\tthread\t\tShow the placement of each player thread role.\n");
+    printf("\tthread <role> cpus <list>\tPin threads of <role> to cpus (e.g. 0-3,8).\n");
+    printf("\tthread <role> numa <node>\tRun <role> on a NUMA node and allocate there.\n");
+    printf("\tthread <role> sched <other|fifo|rr> [priority]\tSet the scheduling policy.\n");
+    printf("\tthread <role> reset\tRestore the default placement.\n");
+    printf("\t\troles: decode (the playback thread), analysis\n");
+
+    printf("\texport <name> [slots]\tPublish decoded frames to the shared memory "
+        "ring <name> from the next load on.\n");
+    printf("\texport off\tStop publishing frames.\n");
+    printf("\tanalyze <output_file>\tWrite luma histogram, black/frozen frame and "
+        "scene change metrics\n\t\tof every frame as JSON lines, from the next load on.\n");
+    printf("\tanalyze off\tStop analyzing frames.\n");
+    printf("\tloop [a b]\tLoop the video, or the segment from <a> to <b> seconds.\n"
+        "\t\tThe first pass is cached in memory and later passes don't read the file.\n");
+    printf("\tloop cap <MB>\tMemory the loop may use to cache the segment.\n");
+    printf("\tloop off\tStop looping.\n");
+    printf("\tmemory <MB>\tLimit the memory of frame buffers, export ring, analysis queue\n"
+        "\t\tand loop cache, sizing them from the frame size on every load.\n");
+    printf("\tmemory off\tRemove the memory limit.\n");
 
     printf("\texit\t\tExit the program.\n");
 }
 
+void thread_command(Player& player, const std::vector<std::string>& tokens) {
+    if (tokens.size() == 1) {
+        player.print_thread_policies();
+        return;
+    }
+
+    THREAD_ROLE role;
+    if (!parse_thread_role(tokens[1], role)) {
+        fprintf(stderr, "Error: Unknown thread role [%s].\n", tokens[1].c_str());
+        return;
+    }
+
+    if (!Player::role_has_thread(role)) {
+        fprintf(stderr, "Error: Role [%s] has no thread, the playback thread "
+            "demuxes, decodes, converts and renders. Use [decode].\n", tokens[1].c_str());
+        return;
+    }
+
+    if (tokens.size() < 3) {
+        fprintf(stderr,
+            "Error: Invalid number of arguments provided.\n"
+            "\tUsage: thread <role> <cpus|numa|sched|reset> [args]\n"
+        );
+        return;
+    }
+
+    ThreadPolicy policy = player.thread_policy(role);
+
+    if (tokens[2].compare("reset") == 0) {
+        policy = ThreadPolicy();
+    } else if (tokens[2].compare("cpus") == 0 && tokens.size() >= 4) {
+        if (!parse_cpu_list(tokens[3], policy.cpus)) {
+            fprintf(stderr, "Error: Invalid cpu list [%s].\n", tokens[3].c_str());
+            return;
+        }
+    } else if (tokens[2].compare("numa") == 0 && tokens.size() >= 4) {
+        char *end {nullptr};
+        long node = strtol(tokens[3].c_str(), &end, 10);
+        if (end == tokens[3].c_str() || *end != '\0' || node < 0 || node > INT_MAX) {
+            fprintf(stderr, "Error: Invalid NUMA node [%s].\n", tokens[3].c_str());
+            return;
+        }
+        policy.numa_node = (int) node;
+        if (numa_node_cpus(policy.numa_node).empty()) {
+            fprintf(stderr, "Error: NUMA node [%s] does not exist.\n", tokens[3].c_str());
+            return;
+        }
+    } else if (tokens[2].compare("sched") == 0 && tokens.size() >= 4) {
+        if (!parse_sched_policy(tokens[3], policy.sched_policy)) {
+            fprintf(stderr, "Error: Unknown scheduling policy [%s].\n", tokens[3].c_str());
+            return;
+        }
+        policy.sched_priority = tokens.size() >= 5 ? atoi(tokens[4].c_str()) : 1;
+    } else {
+        fprintf(stderr, "Error: Unknown thread option [%s].\n", tokens[2].c_str());
+        return;
+    }
+
+    player.set_thread_policy(role, policy);
+    printf("Thread [%s]: %s\n", thread_role_name(role),
+        describe_thread_policy(policy).c_str());
+}
+
+void export_command(Player& player, const std::vector<std::string>& tokens) {
+    if (tokens.size() < 2) {
+        fprintf(stderr,
+            "Error: Invalid number of arguments provided.\n"
+            "\tUsage: export <name|off> [slots]\n"
+        );
+        return;
+    }
+
+    if (tokens[1].compare("off") == 0) {
+        player.disable_export();
+        return;
+    }
+
+    const int slots = tokens.size() >= 3 ? atoi(tokens[2].c_str()) : 4;
+    if (slots < 2) {
+        fprintf(stderr, "Error: The export ring needs at least 2 slots.\n");
+        return;
+    }
+
+    player.set_export(tokens[1], slots);
+}
+
+void analyze_command(Player& player, const std::vector<std::string>& tokens) {
+    if (tokens.size() < 2) {
+        fprintf(stderr,
+            "Error: Invalid number of arguments provided.\n"
+            "\tUsage: analyze <output_file|off>\n"
+        );
+        return;
+    }
+
+    if (tokens[1].compare("off") == 0) {
+        player.disable_analysis();
+    } else {
+        player.set_analysis(tokens[1]);
+    }
+}
+
+void loop_command(Player& player, const std::vector<std::string>& tokens) {
+    if (tokens.size() == 1) {
+        player.set_loop(0.0, -1.0);
+        return;
+    }
+
+    if (tokens[1].compare("off") == 0) {
+        player.disable_loop();
+        return;
+    }
+
+    if (tokens[1].compare("cap") == 0 && tokens.size() >= 3) {
+        const long megabytes = atol(tokens[2].c_str());
+        if (megabytes <= 0) {
+            fprintf(stderr, "Error: Invalid cache size [%s].\n", tokens[2].c_str());
+            return;
+        }
+        player.set_loop_cache_cap((size_t) megabytes << 20);
+        return;
+    }
+
+    if (tokens.size() < 3) {
+        fprintf(stderr,
+            "Error: Invalid number of arguments provided.\n"
+            "\tUsage: loop [<a> <b>|cap <MB>|off]\n"
+        );
+        return;
+    }
+
+    const double start = atof(tokens[1].c_str());
+    const double end = atof(tokens[2].c_str());
+    if (start < 0 || end <= start) {
+        fprintf(stderr, "Error: The loop segment must satisfy 0 <= a < b.\n");
+        return;
+    }
+
+    player.set_loop(start, end);
+}
+
+void memory_command(Player& player, const std::vector<std::string>& tokens) {
+    if (tokens.size() < 2) {
+        fprintf(stderr,
+            "Error: Invalid number of arguments provided.\n"
+            "\tUsage: memory <MB|off>\n"
+        );
+        return;
+    }
+
+    if (tokens[1].compare("off") == 0) {
+        player.set_memory_limit(0);
+        return;
+    }
+
+    const long megabytes = atol(tokens[1].c_str());
+    if (megabytes <= 0) {
+        fprintf(stderr, "Error: Invalid memory limit [%s].\n", tokens[1].c_str());
+        return;
+    }
+    player.set_memory_limit((size_t) megabytes << 20);
+}
+
 std::vector<std::string> tokenize(const std::string& line) {
     std::vector<std::string> tokens;
 
@@ -104,7 +310,7 @@ std::vector<std::string> tokenize(const std::string& line) {
     while (start < line.size() && end <= line.size()) {
 
         if (end >= line.size() || line[end] == ' ') {
-            if (end-start > 1)
+            if (end-start > 0)
                 tokens.push_back(line.substr(start, end-start));
             start = end+1;
             end = start;
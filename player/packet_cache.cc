@@ -0,0 +1,135 @@
+#include "packet_cache.h"
+
+#include <cstring>
+#include <algorithm>
+
+namespace {
+
+const size_t CHUNK_SIZE {4 << 20};
+
+}
+
+PacketCache::~PacketCache() {
+    clear();
+}
+
+void PacketCache::clear() {
+    for (auto *chunk : chunks_) av_buffer_unref(&chunk);
+    for (auto& entry : entries_) {
+        if (entry.props != nullptr) av_packet_free(&entry.props);
+    }
+    chunks_.clear();
+    chunk_used_ = 0;
+    entries_.clear();
+    key_frames_.clear();
+    bytes_ = 0;
+    complete_ = false;
+    overflowed_ = false;
+}
+
+void PacketCache::reset(size_t cap, int64_t from, int64_t until) {
+    clear();
+    cap_ = cap;
+    from_ = from;
+    until_ = until;
+}
+
+bool PacketCache::add(const AVPacket *packet) {
+    if (overflowed_ || complete_) return false;
+
+    // decoders may read a little past the end of the packet,
+    // and packet starts are kept aligned for simd readers
+    const size_t needed = packet->size + AV_INPUT_BUFFER_PADDING_SIZE;
+    const size_t used = (needed + 63) & ~(size_t) 63;
+
+    size_t side_data_size {0};
+    for (int i = 0; i < packet->side_data_elems; ++i) {
+        side_data_size += packet->side_data[i].size;
+    }
+
+    // the cap is charged with what the packets use, not with
+    // whole chunks, so caps below a chunk still hold small segments
+    if (bytes_ + used + side_data_size > cap_) {
+        clear();
+        overflowed_ = true;
+        return false;
+    }
+
+    if (chunks_.empty() || chunk_used_ + needed > (size_t) chunks_.back()->size) {
+        // never allocate past the cap either, the last
+        // chunk gets what is left of it
+        const size_t left = cap_ - bytes_;
+        const size_t chunk_size = std::max(needed, std::min(CHUNK_SIZE, left));
+
+        AVBufferRef *chunk = av_buffer_alloc(chunk_size);
+        if (chunk == nullptr) {
+            clear();
+            overflowed_ = true;
+            return false;
+        }
+        chunks_.push_back(chunk);
+        chunk_used_ = 0;
+    }
+
+    AVPacket *props {nullptr};
+    if (packet->side_data_elems > 0) {
+        props = av_packet_alloc();
+        if (props == nullptr || av_packet_copy_props(props, packet) < 0) {
+            if (props != nullptr) av_packet_free(&props);
+            clear();
+            overflowed_ = true;
+            return false;
+        }
+    }
+
+    AVBufferRef *chunk = chunks_.back();
+    memcpy(chunk->data + chunk_used_, packet->data, packet->size);
+    memset(chunk->data + chunk_used_ + packet->size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+    if (packet->flags & AV_PKT_FLAG_KEY) key_frames_.push_back(entries_.size());
+
+    entries_.push_back(Entry{
+        chunks_.size() - 1, chunk_used_, packet->size,
+        packet->pts, packet->dts, packet->duration,
+        packet->flags, packet->stream_index, props
+    });
+
+    chunk_used_ += used;
+    bytes_ += used + side_data_size;
+    return true;
+}
+
+bool PacketCache::get(size_t index, AVPacket *packet) const {
+    if (index >= entries_.size()) return false;
+
+    const Entry& entry = entries_[index];
+    if (entry.props != nullptr && av_packet_copy_props(packet, entry.props) < 0) {
+        return false;
+    }
+
+    packet->buf = av_buffer_ref(chunks_[entry.chunk]);
+    if (packet->buf == nullptr) {
+        av_packet_unref(packet);
+        return false;
+    }
+
+    packet->data = packet->buf->data + entry.offset;
+    packet->size = entry.size;
+    packet->pts = entry.pts;
+    packet->dts = entry.dts;
+    packet->duration = entry.duration;
+    packet->flags = entry.flags;
+    packet->stream_index = entry.stream_index;
+    return true;
+}
+
+size_t PacketCache::seek_point(int64_t pts) const {
+    size_t point {0};
+    for (size_t index : key_frames_) {
+        const int64_t key_pts = entries_[index].pts != AV_NOPTS_VALUE ?
+            entries_[index].pts : entries_[index].dts;
+        if (key_pts != AV_NOPTS_VALUE && key_pts > pts) break;
+        point = index;
+    }
+    return point;
+}
@@ -0,0 +1,114 @@
+#ifndef _PACKET_CACHE_H_
+#define _PACKET_CACHE_H_
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+
+#include <ffmpeg_extern.h>
+
+/**
+ * @def
+ * Compressed packets of one segment of a video stream, kept in memory
+ * so that looping over the segment doesn't demux the file again.
+ *
+ * Packet data is packed back to back into large ref-counted chunks.
+ * Cached packets handed to the decoder reference their chunk instead
+ * of being copied. Key frame positions are recorded as packets are
+ * added so a pass can start at the right packet without a seek.
+ * Packet side data (new extradata, palettes, ...) is kept with its
+ * packet so cached passes decode like the first one.
+ * */
+class PacketCache {
+
+public:
+    PacketCache() = default;
+    PacketCache(const PacketCache &c) = delete;
+    ~PacketCache();
+
+    void operator=(const PacketCache &c) = delete;
+
+    /**
+     * @def
+     * Drop the cached packets and start caching the segment
+     * [from, until] (in stream time base) using at most [cap] bytes.
+     * */
+    void reset(size_t cap, int64_t from, int64_t until);
+    void clear();
+
+    /**
+     * @def
+     * Copy [packet] into the cache.
+     * @returns false if it would go over the memory cap. The cache is
+     * then emptied and marked as overflowed.
+     * */
+    bool add(const AVPacket *packet);
+
+    /**
+     * @def
+     * Mark that every packet of the segment was added.
+     * */
+    void mark_complete() { complete_ = !overflowed_; }
+
+    bool complete() const { return complete_; }
+    bool overflowed() const { return overflowed_; }
+    bool holds(int64_t from, int64_t until) const {
+        return from_ == from && until_ == until;
+    }
+
+    size_t size() const { return entries_.size(); }
+    /**
+     * @def
+     * Memory used by the cached packets and their side data.
+     * */
+    size_t bytes() const { return bytes_; }
+    size_t cap() const { return cap_; }
+
+    /**
+     * @def
+     * Point [packet] at cached packet [index], referencing the cache's
+     * memory.
+     * */
+    bool get(size_t index, AVPacket *packet) const;
+
+    /**
+     * @def
+     * Index of the last key frame packet at or before [pts], where
+     * decoding has to start to show [pts].
+     * */
+    size_t seek_point(int64_t pts) const;
+
+private:
+    struct Entry {
+        size_t chunk;
+        size_t offset;
+        int size;
+        int64_t pts, dts, duration;
+        int flags;
+        int stream_index;
+        /**
+         * @def
+         * Properties and side data of the packet, only kept for
+         * packets that carry side data.
+         * */
+        AVPacket *props;
+    };
+
+    std::vector<AVBufferRef *> chunks_;
+    size_t chunk_used_ = 0;
+    std::vector<Entry> entries_;
+    /**
+     * @def
+     * Indices into entries_ of key frame packets, in order.
+     * */
+    std::vector<size_t> key_frames_;
+
+    size_t cap_ = 0;
+    size_t bytes_ = 0;
+    int64_t from_ = 0, until_ = 0;
+    bool complete_ = false;
+    bool overflowed_ = false;
+};
+
+#endif
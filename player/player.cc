@@ -1,6 +1,269 @@
 #include "player.h"
 
-Player::~Player () {}
+#include <cmath>
+#include <thread>
+
+Player::~Player () {
+    if (in_use_) stop();
+    release_resources();
+}
+
+void Player::stop () {
+    if (!in_use_) {
+        printf("No video to stop.\n");
+        return;
+    }
+
+    {
+        // under the lock so a paused thread can't miss the wake up
+        std::lock_guard<std::mutex> lock(paused_mtx_);
+        stop_requested_ = true;
+    }
+    paused_cv_.notify_all();
+    pthread_join(video_tid_, nullptr);
+    stop_requested_ = false;
+    finished_ = false;
+    // cached packets belong to this file
+    packet_cache_.clear();
+
+    {
+        const std::lock_guard<std::mutex> lock(fmt_mtx_);
+        avformat_close_input(&format_ctx_);
+    }
+    {
+        std::lock_guard<std::mutex> lock(paused_mtx_);
+        paused_ = false;
+    }
+
+    in_use_ = false;
+    printf("Playback stopped.\n");
+}
+
+void Player::release_resources () {
+    if (codec_ctx_ != nullptr) avcodec_free_context(&codec_ctx_);
+    if (codec_params_ != nullptr) avcodec_parameters_free(&codec_params_);
+    sws_freeContext(sws_ctx_);
+    sws_ctx_ = nullptr;
+    if (packet_ != nullptr) av_packet_free(&packet_);
+    if (frame_ != nullptr) av_frame_free(&frame_);
+    av_freep(&dst_img_buff_[0]);
+    dst_buffsize_ = 0;
+    dst_width_ = dst_height_ = 0;
+    win_.reset();
+    sink_.reset();
+    probe_.reset();
+}
+
+bool Player::open_decoder (const AVCodecParameters *params, const AVCodec *codec) {
+    if (codec_ctx_ != nullptr && codec_params_ != nullptr
+        && codec_params_->codec_id == params->codec_id
+        && codec_params_->width == params->width
+        && codec_params_->height == params->height
+        && codec_params_->format == params->format
+        && codec_params_->extradata_size == params->extradata_size
+        && (params->extradata_size == 0 || memcmp(codec_params_->extradata,
+            params->extradata, params->extradata_size) == 0)) {
+        // same stream layout as the last file, drop the old
+        // decoder state instead of building a new context
+        avcodec_flush_buffers(codec_ctx_);
+        printf("\t\tReusing open decoder.\n");
+        return true;
+    }
+
+    if (codec_ctx_ != nullptr) avcodec_free_context(&codec_ctx_);
+
+    codec_ctx_ = avcodec_alloc_context3(codec);
+    if (codec_ctx_ == nullptr) {
+        fprintf(stderr, "Error: Codec ctx initialization failed.\n");
+        return false;
+    }
+
+    if (avcodec_parameters_to_context(codec_ctx_, params) < 0) {
+        fprintf(stderr, "Error: Failed to fill codec context from parameters.\n");
+        avcodec_free_context(&codec_ctx_);
+        return false;
+    }
+
+    // tell the codec context to use the codec
+    // for this video stream
+    if (avcodec_open2(codec_ctx_, codec, nullptr) < 0) {
+        fprintf(stderr, "Error: Failed to open codec with avcodec_open2\n");
+        avcodec_free_context(&codec_ctx_);
+        return false;
+    }
+
+    if (codec_params_ == nullptr) codec_params_ = avcodec_parameters_alloc();
+    if (codec_params_ == nullptr
+        || avcodec_parameters_copy(codec_params_, params) < 0) {
+        // without a copy the decoder can't be matched later
+        if (codec_params_ != nullptr) avcodec_parameters_free(&codec_params_);
+    }
+
+    return true;
+}
+
+MemoryPlan plan_memory (size_t limit, size_t rgb_frame, size_t decoded_frame,
+    int export_slots, size_t probe_queue, size_t cache_cap) {
+    MemoryPlan plan {export_slots, probe_queue, cache_cap};
+    if (limit == 0) return plan;
+
+    // the converted frame (window buffer or one ring slot)
+    // is needed no matter what
+    size_t left = limit > rgb_frame ? limit - rgb_frame : 0;
+    if (left == 0) {
+        fprintf(stderr, "Warning: One frame needs %zu MB, more than the %zu MB "
+            "memory limit.\n", rgb_frame >> 20, limit >> 20);
+    }
+
+    // the export ring may take half of what is left, but needs two
+    // slots. Its first slot is the converted frame counted above.
+    if (export_slots > 0) {
+        size_t slots = rgb_frame > 0 ? 1 + left / 2 / rgb_frame : export_slots;
+        if (slots < 2) slots = 2;
+        if (slots < (size_t) export_slots) plan.export_slots = slots;
+        size_t ring = (plan.export_slots - 1) * rgb_frame;
+        left = left > ring ? left - ring : 0;
+    }
+
+    // analysis holds references to decoded frames, half of the rest
+    if (probe_queue > 0) {
+        size_t queue = decoded_frame > 0 ? left / 2 / decoded_frame : probe_queue;
+        if (queue < 1) queue = 1;
+        if (queue < probe_queue) plan.probe_queue = queue;
+        size_t held = plan.probe_queue * decoded_frame;
+        left = left > held ? left - held : 0;
+    }
+
+    // the loop cache gets the remainder
+    if (left < plan.cache_cap) plan.cache_cap = left;
+
+    return plan;
+}
+
+bool Player::prepare_output (PlaybackState& state) {
+    const int width {state.width};
+    const int height {state.height};
+
+    if (packet_ == nullptr) packet_ = av_packet_alloc();
+    if (frame_ == nullptr) frame_ = av_frame_alloc();
+    if (packet_ == nullptr || frame_ == nullptr) {
+        fprintf(stderr, "Error: Failed to initialize packet or frame.\n");
+        return false;
+    }
+
+    std::string export_name;
+    int export_slots;
+    {
+        std::lock_guard<std::mutex> lock(export_mtx_);
+        export_name = export_name_;
+        export_slots = export_slots_;
+    }
+
+    std::string analysis_path;
+    {
+        std::lock_guard<std::mutex> lock(analysis_mtx_);
+        analysis_path = analysis_path_;
+    }
+
+    size_t memory_limit;
+    {
+        std::lock_guard<std::mutex> lock(memory_mtx_);
+        memory_limit = memory_limit_;
+    }
+
+    size_t cache_cap;
+    {
+        std::lock_guard<std::mutex> lock(loop_mtx_);
+        cache_cap = loop_cache_cap_;
+    }
+
+    // size the ring, the analysis queue and the loop cache from
+    // the frame size so the whole chain stays under the limit
+    const int rgb_size = av_image_get_buffer_size(state.out_format, width, height, 1);
+    const int decoded_size = av_image_get_buffer_size(
+        state.codec_ctx->pix_fmt == AV_PIX_FMT_NONE ? AV_PIX_FMT_YUV420P
+            : state.codec_ctx->pix_fmt, width, height, 1);
+    memory_plan_ = plan_memory(memory_limit,
+        rgb_size > 0 ? rgb_size : 0, decoded_size > 0 ? decoded_size : 0,
+        export_name.empty() ? 0 : export_slots,
+        analysis_path.empty() ? 0 : FRAME_PROBE_QUEUE, cache_cap);
+    if (memory_limit > 0) {
+        printf("Memory plan (%zu MB limit, %d MB frames): export slots %d, "
+            "analysis queue %zu, loop cache %zu MB.\n",
+            memory_limit >> 20, rgb_size >> 20, memory_plan_.export_slots,
+            memory_plan_.probe_queue, memory_plan_.cache_cap >> 20);
+    }
+    export_slots = memory_plan_.export_slots;
+
+    if (export_name.empty()) {
+        sink_.reset();
+    } else if (sink_ == nullptr || sink_->name() != export_name
+        || sink_->slot_count() != export_slots
+        || sink_->width() != width || sink_->height() != height
+        || sink_->format() != state.out_format) {
+        sink_.reset(new ShmFrameSink);
+        if (!sink_->open(export_name, export_slots, width, height, state.out_format)) {
+            fprintf(stderr, "Error: Failed to export frames, playing without export.\n");
+            sink_.reset();
+        }
+    }
+
+    if (sink_ != nullptr) {
+        // frames are converted into the ring, the buffer isn't needed
+        av_freep(&dst_img_buff_[0]);
+        dst_width_ = dst_height_ = 0;
+    } else if (width != dst_width_ || height != dst_height_
+        || state.out_format != dst_format_) {
+        av_freep(&dst_img_buff_[0]);
+        dst_width_ = dst_height_ = 0;
+
+        dst_buffsize_ = av_image_alloc(dst_img_buff_, dst_linesize_,
+            width, height, state.out_format, 1);
+        if (dst_buffsize_ < 0) {
+            fprintf(stderr, "Error: Failed to allocate av iamge buffer.\n");
+            return false;
+        }
+        // fault the frame buffer in from this thread so it lands
+        // on the thread's NUMA node
+        touch_pages(dst_img_buff_[0], dst_buffsize_);
+
+        dst_width_ = width;
+        dst_height_ = height;
+        dst_format_ = state.out_format;
+    }
+
+    if (state.headless) {
+        // nothing is drawn, a window left from an earlier
+        // load is kept for the next one that needs it
+        return true;
+    }
+
+    if (win_ != nullptr && win_->ok()
+        && win_->width() == (uint) width && win_->height() == (uint) height) {
+        win_->make_current();
+    } else {
+        win_.reset(new window);
+        win_->init(width, height);
+    }
+
+    if (!win_->ok()) {
+        fprintf(stderr, "Error: Failed to initialize window.\n");
+        win_.reset();
+        return false;
+    }
+
+    return true;
+}
+
+void Player::set_memory_limit (size_t bytes) {
+    std::lock_guard<std::mutex> lock(memory_mtx_);
+    memory_limit_ = bytes;
+    if (bytes == 0) {
+        printf("Memory limit removed.\n");
+    } else {
+        printf("Memory limit set to %zu MB from the next load on.\n", bytes >> 20);
+    }
+}
 
 void Player::pause () {
     if (!in_use_) {
@@ -18,15 +281,100 @@ void Player::resume () {
         printf("No video to resume.\n");
         return;
     }
-    std::lock_guard<std::mutex> lock(paused_mtx_);
-    if (paused_) {
-        paused_ = false;
+    {
+        std::lock_guard<std::mutex> lock(paused_mtx_);
+        if (paused_) {
+            paused_ = false;
+        }
+    }
+    paused_cv_.notify_all();
+}
+
+void Player::set_thread_policy (THREAD_ROLE role, const ThreadPolicy& policy) {
+    std::lock_guard<std::mutex> lock(policy_mtx_);
+    thread_policies_[role] = policy;
+}
+
+ThreadPolicy Player::thread_policy (THREAD_ROLE role) {
+    std::lock_guard<std::mutex> lock(policy_mtx_);
+    return thread_policies_[role];
+}
+
+void Player::print_thread_policies () {
+    std::lock_guard<std::mutex> lock(policy_mtx_);
+    printf("Thread Placement:\n");
+    for (int i = 0; i < THREAD_ROLE_COUNT; ++i) {
+        if (!role_has_thread((THREAD_ROLE) i)) {
+            printf("\t%s\t(runs on the decode thread)\n", thread_role_name((THREAD_ROLE) i));
+            continue;
+        }
+        printf("\t%s\t%s\n", thread_role_name((THREAD_ROLE) i),
+            describe_thread_policy(thread_policies_[i]).c_str());
+    }
+}
+
+bool Player::role_has_thread (THREAD_ROLE role) {
+    return role == ROLE_DECODE || role == ROLE_ANALYSIS;
+}
+
+void Player::set_export (const std::string& name, int slots) {
+    std::lock_guard<std::mutex> lock(export_mtx_);
+    export_name_ = name[0] == '/' ? name : "/" + name;
+    export_slots_ = slots;
+    printf("Frames of the next video are exported to [%s] (%d slots).\n",
+        export_name_.c_str(), export_slots_);
+}
+
+void Player::disable_export () {
+    std::lock_guard<std::mutex> lock(export_mtx_);
+    export_name_.clear();
+    printf("Frame export disabled for the next video.\n");
+}
+
+void Player::set_analysis (const std::string& path) {
+    std::lock_guard<std::mutex> lock(analysis_mtx_);
+    analysis_path_ = path;
+    printf("Frames of the next video are analyzed into [%s].\n", path.c_str());
+}
+
+void Player::disable_analysis () {
+    std::lock_guard<std::mutex> lock(analysis_mtx_);
+    analysis_path_.clear();
+    printf("Frame analysis disabled for the next video.\n");
+}
+
+void Player::set_loop (double start, double end) {
+    std::lock_guard<std::mutex> lock(loop_mtx_);
+    loop_enabled_ = true;
+    loop_start_ = start;
+    loop_end_ = end;
+    if (end > start) {
+        printf("Looping %.3fs to %.3fs.\n", start, end);
+    } else {
+        printf("Looping the whole video.\n");
     }
 }
 
+void Player::disable_loop () {
+    std::lock_guard<std::mutex> lock(loop_mtx_);
+    loop_enabled_ = false;
+    printf("Looping disabled.\n");
+}
+
+void Player::set_loop_cache_cap (size_t bytes) {
+    std::lock_guard<std::mutex> lock(loop_mtx_);
+    loop_cache_cap_ = bytes;
+    printf("Loop packet cache limited to %zu MB.\n", bytes >> 20);
+}
+
 void Player::load_file(const std::string& path) {
+    if (in_use_ && finished_) {
+        // the last video played to the end, reclaim its thread
+        stop();
+    }
+
     if (in_use_) {
-        printf("Player is in use. Type \"end\" to stop the player.\n");
+        printf("Player is in use. Type \"stop\" to stop the player.\n");
         return;
     }
 
@@ -53,6 +401,7 @@ void Player::load_file(const std::string& path) {
     );
 
     if (res != 0) {
+        // avformat_open_input frees the context on failure
         fprintf(stderr, "Error: Failed to open input.\n");
         return;
     }
@@ -76,6 +425,7 @@ void Player::load_file(const std::string& path) {
     res = avformat_find_stream_info(format_ctx_, nullptr);
     if (res < 0) {
         fprintf(stderr, "Error: Failed to find stream info.\n");
+        avformat_close_input(&format_ctx_);
         return;
     }
 
@@ -84,7 +434,6 @@ void Player::load_file(const std::string& path) {
 
     bool video_initialized {false};
     int stream_index {-1};
-    AVCodecContext *codec_ctx {nullptr};
 
     printf("Stream Info:\n");
     for (int i = 0; i < format_ctx_->nb_streams; ++i) {
@@ -123,24 +472,7 @@ void Player::load_file(const std::string& path) {
             printf("\t\tHeight:\t%d\n", local_params->height);
 
             if (!video_initialized) {
-                codec_ctx = avcodec_alloc_context3(p_codec);
-                if (codec_ctx == nullptr) {
-                    fprintf(stderr, "Error: Codec ctx initialization failed "
-                        "for this video stream codec.. Trying next stream.\n"
-                        "(stream id=%d)\n", i);
-                    continue;
-                }
-
-                if (avcodec_parameters_to_context(codec_ctx, local_params) < 0) {
-                    fprintf(stderr, "Error: Failed to fill codec context from parameters.\n");
-                    fprintf(stderr, "Trying next video stream.\n(stream id =%d)\n", i);
-                    continue;
-                }
-
-                // tell the codec context to use the codec
-                // for this video stream
-                if (avcodec_open2(codec_ctx, p_codec, nullptr) < 0) {
-                    fprintf(stderr, "Error: Failed to open codec with avcodec_open2\n");
+                if (!open_decoder(local_params, p_codec)) {
                     fprintf(stderr, "Trying next video stream.\n(stream id=%d)\n", i);
                     continue;
                 }
@@ -160,149 +492,307 @@ void Player::load_file(const std::string& path) {
 
     if (!video_initialized) {
         fprintf(stderr, "Error: No valid video stream found to play.\n");
-        if (codec_ctx != nullptr) avcodec_free_context(&codec_ctx);
         avformat_close_input(&format_ctx_);
     } else {
 
-        in_use_ = true;
-
         auto *vid_params = new VideoInfo;
         vid_params->player = this;
         vid_params->stream_index = stream_index;
-        vid_params->codec_ctx = codec_ctx;
+        vid_params->codec_ctx = codec_ctx_;
 
-        pthread_t tid;
-        pthread_create(
-            &tid,
+        stop_requested_ = false;
+        finished_ = false;
+        res = pthread_create(
+            &video_tid_,
             nullptr,
             play_video_thread,
             (void *) vid_params
         );
+
+        if (res != 0) {
+            fprintf(stderr, "Error: Failed to start playback thread.\n");
+            delete vid_params;
+            avformat_close_input(&format_ctx_);
+        } else {
+            in_use_ = true;
+        }
     }
 }
 
 void * play_video_thread (void* params) {
-    // TODO play the video information
     struct VideoInfo *vid_params = (VideoInfo*) params;
-    if (vid_params->player != nullptr
-        && vid_params->stream_index >= 0
-        && vid_params->stream_index < vid_params->player->format_ctx_->nb_streams) {
-        const std::lock_guard<std::mutex> fmt_lock(vid_params->player->fmt_mtx_);
-        AVPacket *packet = av_packet_alloc();
-        AVFrame *frame = av_frame_alloc();
-
-        // create swscale context for converting from yuv to rgb
-        const uint WIDTH {640};
-        const uint HEIGHT {360};
-        struct SwsContext *sws_ctx = sws_getContext(
-            WIDTH, HEIGHT, AV_PIX_FMT_YUV420P,
-            WIDTH, HEIGHT, AV_PIX_FMT_RGB24,
-            SWS_BILINEAR, nullptr, nullptr, nullptr);
-        uint8_t *dst_img_buff[4];
-        int dst_linesize[4];
-        auto dst_buffsize = av_image_alloc(dst_img_buff, dst_linesize,
-            WIDTH, HEIGHT, AV_PIX_FMT_RGB24, 1);
-
-        // Initialize window here!
-        // Fuck sfml. It's asking me for too much >_>
+    Player *player = vid_params->player;
+
+    // this thread demuxes, decodes, converts and renders,
+    // so it is placed with the decoder policy
+    apply_thread_policy(ROLE_DECODE, player->thread_policy(ROLE_DECODE));
+
+    if (vid_params->stream_index >= 0
+        && vid_params->stream_index < player->format_ctx_->nb_streams) {
+        const std::lock_guard<std::mutex> fmt_lock(player->fmt_mtx_);
+        AVStream *stream = player->format_ctx_->streams[vid_params->stream_index];
+
+        PlaybackState state;
+        state.codec_ctx = vid_params->codec_ctx;
+        state.stream_index = vid_params->stream_index;
+        state.width = state.codec_ctx->width;
+        state.height = state.codec_ctx->height;
+        state.time_base = stream->time_base;
+        state.frame_rate = av_q2d(stream->r_frame_rate);
+        if (state.frame_rate == 0) state.frame_rate = (double) 1.0f;
+        state.headless = player->headless_;
+
+        // sources deeper than 8 bits are converted to 16-bit rgb
+        // instead of being truncated
+        auto src_desc = av_pix_fmt_desc_get(state.codec_ctx->pix_fmt);
+        if (src_desc != nullptr && src_desc->comp[0].depth > 8) {
+            state.out_format = AV_PIX_FMT_RGB48;
+            state.bytes_per_channel = 2;
+        }
 
         printf("\nBeginning Frame Extraction.\n");
 
-        if (packet == nullptr || frame == nullptr) {
-           fprintf(stderr, "Error: Failed to initialize packet or frame.\n");
-        } else if (sws_ctx == nullptr) {
-            fprintf(stderr, "Error: Failed to initialize swscale.\n");
-        } else if (dst_buffsize < 0) {
-            fprintf(stderr, "Error: Failed to allocate av iamge buffer.\n");
-        } else {
-            window win;
-            win.init(WIDTH, HEIGHT);
-            auto frame_rate_rat = 
-                vid_params->player->format_ctx_->streams[vid_params->stream_index]->r_frame_rate;
-            auto frame_rate = av_q2d(frame_rate_rat);
-            if (frame_rate == 0) frame_rate = (double) 1.0f;
-            auto last_frame_time = std::chrono::system_clock::now();
-
-            bool supported_pixel_format {true};
-
-            while (
-                supported_pixel_format
-                && av_read_frame(
-                vid_params->player->format_ctx_,
-                packet
-            ) >= 0) {
-
-                if (packet->stream_index == vid_params->stream_index) {
-
-                    // decode the packet into a frame
-                    int res = avcodec_send_packet(vid_params->codec_ctx, packet);
-                    if (res < 0) {
-                        fprintf(stderr, "Error while sending packet to decoder.\n");
-                    } else {
-
-                        while (res >= 0) {
-                            res = avcodec_receive_frame(vid_params->codec_ctx, frame);
-
-                            if (res == AVERROR(EAGAIN) || res == AVERROR_EOF) {
-                                break;
-                            } else if (res >= 0) {
-                                /* printf("Frame %d (size=%d bytes, format=%d) "
-                                    "pts %ld key_frame %d dts %d\n",
-                                    vid_params->codec_ctx->frame_number,
-                                    // av_get_picture_type_char(frame->pict_type),
-                                    frame->pkt_size,
-                                    frame->format,
-                                    frame->pts,
-                                    frame->key_frame,
-                                    frame->coded_picture_number); */
-                                if (frame->format == AV_PIX_FMT_YUV420P) {
-                                    // convert the frame into rgb
-                                    
-                                    sws_scale(sws_ctx, frame->data, frame->linesize,
-                                        0, frame->height, dst_img_buff, dst_linesize);
-
-                                    while (true) {
-                                        std::lock_guard<std::mutex> lock(vid_params->player->paused_mtx_);
-                                        if (!vid_params->player->paused_) 
-                                            break;
-                                    }
-
-                                    std::chrono::duration<float> diff;
-                                    do {
-                                        diff = std::chrono::system_clock::now() - last_frame_time;
-                                    } while (diff.count() < 1.0f/frame_rate);
-
-                                    win.draw_image((const uint8_t *)dst_img_buff[0], 
-                                        WIDTH, HEIGHT);
-                                    last_frame_time = std::chrono::system_clock::now();
-                                } else {
-                                    auto format_desc = av_pix_fmt_desc_get((AVPixelFormat) frame->format);
-
-                                    fprintf(stderr, "Error: Pixel format [%s] is not supported...",
-                                        format_desc == nullptr ? "null" : format_desc->name);
-                                    fprintf(stderr, "Terminating player.\n");
-                                    supported_pixel_format = false;
-                                    break;
-                                }
-                            }
-                        }
-                        
-                    }
+        if (player->prepare_output(state)) {
+            AVPacket *packet = player->packet_;
+
+            std::string analysis_path;
+            {
+                std::lock_guard<std::mutex> lock(player->analysis_mtx_);
+                analysis_path = player->analysis_path_;
+            }
+            if (!analysis_path.empty()) {
+                if (player->probe_ == nullptr) player->probe_.reset(new FrameProbe);
+                player->probe_->start(analysis_path,
+                    player->thread_policy(ROLE_ANALYSIS), state.time_base,
+                    player->memory_plan_.probe_queue);
+            }
+
+            // the cache belongs to the last file
+            player->packet_cache_.clear();
+            state.last_frame_time = std::chrono::steady_clock::now();
+
+            bool playing = player->begin_pass(state, true);
+            while (playing && !state.failed && !player->stop_requested_) {
+
+                if (player->next_packet(state, packet)) {
+                    player->decode_packet(state, packet);
+                    av_packet_unref(packet);
+                    continue;
+                }
+
+                // end of the pass, show the frames still in the decoder
+                player->decode_packet(state, nullptr);
+
+                if (state.caching) {
+                    player->packet_cache_.mark_complete();
+                    printf("Loop: cached %zu packets (%zu MB), "
+                        "next passes play from memory.\n",
+                        player->packet_cache_.size(), player->packet_cache_.bytes() >> 20);
                 }
 
-                av_packet_unref(packet);
+                playing = player->begin_pass(state, false);
             }
 
-            av_freep(&dst_img_buff[0]);
-            sws_freeContext(sws_ctx);
+            av_frame_unref(player->frame_);
+            if (player->probe_ != nullptr) player->probe_->stop();
+            // let the next playback thread take over the window
+            if (!state.headless) player->win_->release_current();
         }
     }
 
     printf("Exiting load video task.\n");
     delete vid_params;
+    player->finished_ = true;
     return (void*) nullptr;
 }
 
+bool Player::begin_pass (PlaybackState& state, bool first) {
+    bool loop_enabled;
+    double loop_start, loop_end;
+    size_t cache_cap;
+    {
+        std::lock_guard<std::mutex> lock(loop_mtx_);
+        loop_enabled = loop_enabled_;
+        loop_start = loop_start_;
+        loop_end = loop_end_;
+        cache_cap = loop_cache_cap_;
+    }
+
+    if (!first && !loop_enabled) return false;
+
+    state.caching = false;
+    state.from_cache = false;
+    state.show_from = INT64_MIN;
+    state.show_until = INT64_MAX;
+
+    AVStream *stream = format_ctx_->streams[state.stream_index];
+    const int64_t start_time = stream->start_time == AV_NOPTS_VALUE ? 0 : stream->start_time;
+    const double tb = av_q2d(state.time_base);
+
+    if (loop_enabled && loop_end > loop_start) {
+        state.show_from = start_time + llround(loop_start / tb);
+        state.show_until = start_time + llround(loop_end / tb);
+    } else if (loop_enabled && loop_start > 0) {
+        state.show_from = start_time + llround(loop_start / tb);
+    }
+
+    if (!first) {
+        // drop what the decoder holds from the end of the last pass
+        avcodec_flush_buffers(state.codec_ctx);
+    }
+
+    if (loop_enabled && packet_cache_.complete()
+        && packet_cache_.holds(state.show_from, state.show_until)) {
+        // no disk reads or demuxing from here on
+        state.from_cache = true;
+        state.cache_index = packet_cache_.seek_point(state.show_from);
+        return true;
+    }
+
+    if (!first || state.show_from != INT64_MIN) {
+        const int64_t target = state.show_from == INT64_MIN ? start_time : state.show_from;
+        if (av_seek_frame(format_ctx_, state.stream_index, target, AVSEEK_FLAG_BACKWARD) < 0) {
+            fprintf(stderr, "Error: Failed to seek to the start of the loop.\n");
+            return false;
+        }
+    }
+
+    // cache the pass unless the segment is already known not to fit
+    if (loop_enabled && !(packet_cache_.overflowed()
+        && packet_cache_.holds(state.show_from, state.show_until))) {
+        if (memory_plan_.cache_cap < cache_cap) cache_cap = memory_plan_.cache_cap;
+        packet_cache_.reset(cache_cap, state.show_from, state.show_until);
+        state.caching = true;
+    }
+
+    return true;
+}
+
+bool Player::next_packet (PlaybackState& state, AVPacket *packet) {
+    if (state.from_cache) {
+        return packet_cache_.get(state.cache_index++, packet);
+    }
+
+    while (av_read_frame(format_ctx_, packet) >= 0) {
+        if (packet->stream_index != state.stream_index) {
+            av_packet_unref(packet);
+            continue;
+        }
+
+        // packets come in decode order and a frame can't be decoded
+        // after its own pts, so once the dts is past the segment no
+        // frame of the segment is left
+        const int64_t ts = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+        if (ts != AV_NOPTS_VALUE && ts > state.show_until) {
+            av_packet_unref(packet);
+            return false;
+        }
+
+        if (state.caching && !packet_cache_.add(packet)) {
+            state.caching = false;
+            printf("Loop: segment is larger than the %zu MB packet cache, "
+                "reading it from the file every pass.\n", packet_cache_.cap() >> 20);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+void Player::decode_packet (PlaybackState& state, AVPacket *packet) {
+    // decode the packet into a frame
+    int res = avcodec_send_packet(state.codec_ctx, packet);
+    if (res < 0) {
+        if (packet != nullptr) {
+            fprintf(stderr, "Error while sending packet to decoder.\n");
+        }
+        return;
+    }
+
+    while (res >= 0 && !state.failed && !stop_requested_) {
+        res = avcodec_receive_frame(state.codec_ctx, frame_);
+
+        if (res == AVERROR(EAGAIN) || res == AVERROR_EOF) {
+            break;
+        } else if (res >= 0) {
+            present_frame(state, frame_);
+        }
+    }
+}
+
+void Player::present_frame (PlaybackState& state, AVFrame *frame) {
+    const int64_t pts = frame->best_effort_timestamp;
+    if (pts != AV_NOPTS_VALUE && (pts < state.show_from || pts > state.show_until)) {
+        // lead-in to a loop segment
+        return;
+    }
+
+    if (probe_ != nullptr) {
+        probe_->submit(frame);
+    }
+
+    if (!sws_isSupportedInput((AVPixelFormat) frame->format)) {
+        auto format_desc = av_pix_fmt_desc_get((AVPixelFormat) frame->format);
+
+        fprintf(stderr, "Error: Pixel format [%s] is not supported...",
+            format_desc == nullptr ? "null" : format_desc->name);
+        fprintf(stderr, "Terminating player.\n");
+        state.failed = true;
+        return;
+    }
+
+    // convert the frame into rgb, the cached
+    // context is only rebuilt if the input changes
+    sws_ctx_ = sws_getCachedContext(
+        sws_ctx_,
+        frame->width, frame->height,
+        (AVPixelFormat) frame->format,
+        state.width, state.height, state.out_format,
+        SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (sws_ctx_ == nullptr) {
+        fprintf(stderr, "Error: Failed to initialize swscale.\n");
+        state.failed = true;
+        return;
+    }
+
+    // when exporting, convert straight into the
+    // ring slot and draw from there
+    uint8_t *slot_data[4];
+    int slot_linesize[4];
+    uint8_t **dst_data = dst_img_buff_;
+    int *dst_linesize = dst_linesize_;
+    if (sink_ != nullptr) {
+        sink_->begin_frame(slot_data, slot_linesize);
+        dst_data = slot_data;
+        dst_linesize = slot_linesize;
+    }
+
+    sws_scale(sws_ctx_, frame->data, frame->linesize,
+        0, frame->height, dst_data, dst_linesize);
+
+    if (sink_ != nullptr) {
+        sink_->commit_frame(pts, state.time_base);
+    }
+    ++frames_presented_;
+
+    if (state.headless) return;
+
+    // block rather than spin, the thread may run at real-time
+    // priority and would starve its cpus
+    {
+        std::unique_lock<std::mutex> lock(paused_mtx_);
+        paused_cv_.wait(lock, [this] { return !paused_ || stop_requested_; });
+    }
+
+    const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / state.frame_rate));
+    std::this_thread::sleep_until(state.last_frame_time + period);
+
+    win_->draw_image((const uint8_t *) dst_data[0], state.width, state.height,
+        state.bytes_per_channel);
+    state.last_frame_time = std::chrono::steady_clock::now();
+}
+
 bool file_exists (const char* filepath) {
     struct stat buff;
     return stat(filepath, &buff) == 0;
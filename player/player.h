@@ -5,10 +5,19 @@
 #include <sys/stat.h>
 #include <cstdio>
 #include <mutex>
+#include <condition_variable>
 #include <vector>
 #include <chrono>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <cstring>
 #include <pthread.h>
 #include "../window/window.h"
+#include "thread_policy.h"
+#include "packet_cache.h"
+#include "../sink/shm_sink.h"
+#include "../analysis/frame_probe.h"
 
 // #include <libavcodec/codec_id.h>
 // #include <libavutil/avutil.h>
@@ -24,11 +33,72 @@ struct VideoInfo {
     int stream_index = -1;
 };
 
+/**
+ * @def
+ * State of one playback, owned by the playback thread.
+ * show_from, show_until: frames outside this range (stream time base)
+ *  are decoded but not shown, e.g. the lead-in from the key frame
+ *  before a loop segment.
+ * caching: the packets read in this pass are added to the cache.
+ * from_cache: this pass is fed from the cache, starting at cache_index.
+ * */
+struct PlaybackState {
+    AVCodecContext *codec_ctx = nullptr;
+    int stream_index = -1;
+    int width = 0, height = 0;
+    AVRational time_base = {0, 1};
+    double frame_rate = 1.0;
+    /**
+     * @def
+     * Format frames are converted to for the window: RGB24, or RGB48
+     * for sources with more than 8 bits per component.
+     * */
+    AVPixelFormat out_format = AV_PIX_FMT_RGB24;
+    int bytes_per_channel = 1;
+    std::chrono::steady_clock::time_point last_frame_time;
+    /**
+     * @def
+     * true => frames are decoded and converted but not shown, and
+     * playback isn't paced to the frame rate.
+     * */
+    bool headless = false;
+
+    int64_t show_from = INT64_MIN;
+    int64_t show_until = INT64_MAX;
+    bool caching = false;
+    bool from_cache = false;
+    size_t cache_index = 0;
+    bool failed = false;
+};
+
+/**
+ * @def
+ * How a memory limit is shared out for one video.
+ * */
+struct MemoryPlan {
+    int export_slots;
+    size_t probe_queue;
+    size_t cache_cap;
+};
+
+/**
+ * @def
+ * Fit the export ring, the analysis queue and the loop packet cache
+ * under [limit] bytes given the size of a converted [rgb_frame] and of
+ * a [decoded_frame]. The requested sizes are only ever lowered, the
+ * ring keeps at least 2 slots and the queue 1 frame. [limit] 0 means
+ * no limit.
+ * */
+MemoryPlan plan_memory (size_t limit, size_t rgb_frame, size_t decoded_frame,
+    int export_slots, size_t probe_queue, size_t cache_cap);
+
 void * play_video_thread (void* params);
 class Player {
 
 public:
-    Player () : in_use_(false), paused_(false) {}
+    Player () : in_use_(false), paused_(false),
+        stop_requested_(false), finished_(false),
+        headless_(false), frames_presented_(0) {}
     ~Player();
 
     /**
@@ -36,10 +106,84 @@ public:
      * video player.
      * */
     void load_file(const std::string& path);
+
+    /**
+     * @def Stop the loaded video. Joins the playback thread and
+     * closes the file. The decoder, scaler, frame buffers and window
+     * are kept so the next load can recycle them.
+     * */
+    void stop();
     
     void pause();
     void resume();
 
+    /**
+     * @def true => the playback thread has returned, the video
+     * played to the end or could not be played.
+     * */
+    bool finished() const { return finished_; }
+
+    /**
+     * @def Play the next loads without a window: frames are decoded,
+     * converted and exported as usual but not drawn or paced. For
+     * tests and machines without a display.
+     * */
+    void set_headless(bool headless) { headless_ = headless; }
+
+    /**
+     * @def Number of frames converted since the player was created.
+     * */
+    uint64_t frames_presented() const { return frames_presented_; }
+
+    /**
+     * @def Set the placement used by threads of [role]. Takes
+     * effect for threads started after the call.
+     * */
+    void set_thread_policy(THREAD_ROLE role, const ThreadPolicy& policy);
+    ThreadPolicy thread_policy(THREAD_ROLE role);
+    void print_thread_policies();
+
+    /**
+     * @def true => the player starts threads of [role]. The playback
+     * thread demuxes, decodes, converts and renders under ROLE_DECODE,
+     * the other stages have no thread of their own yet.
+     * */
+    static bool role_has_thread(THREAD_ROLE role);
+
+    /**
+     * @def Publish the frames of the next loads into the shared
+     * memory ring [name] with [slots] slots, or stop publishing.
+     * */
+    void set_export(const std::string& name, int slots);
+    void disable_export();
+
+    /**
+     * @def Append per-frame signal metrics of the next loads to
+     * [path] as JSON lines, or stop analyzing.
+     * */
+    void set_analysis(const std::string& path);
+    void disable_analysis();
+
+    /**
+     * @def Loop over the whole video or, if [end] > [start], over the
+     * segment [start, end] in seconds. The segment's packets are cached
+     * on the first pass so later passes don't read the file.
+     * */
+    void set_loop(double start, double end);
+    void disable_loop();
+    /**
+     * @def Memory the loop may use to cache packets.
+     * */
+    void set_loop_cache_cap(size_t bytes);
+
+    /**
+     * @def Upper bound for the memory of frame buffers, the export
+     * ring, the analysis queue and the loop cache together. Their
+     * depths are derived from it and the frame size on every load.
+     * 0 removes the bound.
+     * */
+    void set_memory_limit(size_t bytes);
+
 private:
 
     /**
@@ -56,6 +200,126 @@ private:
     bool in_use_;
     bool paused_;
     std::mutex paused_mtx_;
+    /**
+     * @def
+     * Signalled on resume and stop. The playback thread sleeps on it
+     * while paused instead of spinning, which matters when it runs
+     * with a real-time scheduling policy.
+     * */
+    std::condition_variable paused_cv_;
+
+    pthread_t video_tid_;
+    /**
+     * @def
+     * stop_requested_ => the playback thread should return asap.
+     * finished_ => the playback thread has returned and can be joined.
+     * */
+    std::atomic<bool> stop_requested_;
+    std::atomic<bool> finished_;
+
+    std::atomic<bool> headless_;
+    std::atomic<uint64_t> frames_presented_;
+
+    /**
+     * Resources that outlive a single load. The next load reuses
+     * them when its video stream has the same codec parameters
+     * (decoder) or dimensions (buffers, window) instead of
+     * rebuilding them. Only touched by the playback thread while
+     * a video is loaded.
+     * */
+    AVCodecContext *codec_ctx_ = nullptr;
+    AVCodecParameters *codec_params_ = nullptr;
+    SwsContext *sws_ctx_ = nullptr;
+    AVPacket *packet_ = nullptr;
+    AVFrame *frame_ = nullptr;
+    uint8_t *dst_img_buff_[4] = {nullptr};
+    int dst_linesize_[4] = {0};
+    int dst_buffsize_ = 0;
+    int dst_width_ = 0, dst_height_ = 0;
+    AVPixelFormat dst_format_ = AV_PIX_FMT_NONE;
+    std::unique_ptr<window> win_;
+
+    std::mutex export_mtx_;
+    std::string export_name_;
+    int export_slots_ = 0;
+    /**
+     * @def
+     * Shared memory ring the converted frames are written into
+     * when exporting, in place of dst_img_buff_.
+     * */
+    std::unique_ptr<ShmFrameSink> sink_;
+
+    std::mutex analysis_mtx_;
+    std::string analysis_path_;
+    /**
+     * @def
+     * Running while a video plays with analysis enabled. Gets every
+     * decoded frame before conversion.
+     * */
+    std::unique_ptr<FrameProbe> probe_;
+
+    std::mutex loop_mtx_;
+    bool loop_enabled_ = false;
+    double loop_start_ = 0.0, loop_end_ = -1.0;
+    size_t loop_cache_cap_ = 256 << 20;
+    PacketCache packet_cache_;
+
+    std::mutex memory_mtx_;
+    /**
+     * @def
+     * Limit from set_memory_limit. memory_plan_ is derived from it
+     * by the playback thread on each load.
+     * */
+    size_t memory_limit_ = 0;
+    MemoryPlan memory_plan_ = {0, 0, 0};
+
+    std::mutex policy_mtx_;
+    ThreadPolicy thread_policies_[THREAD_ROLE_COUNT];
+
+    /**
+     * @def
+     * Make codec_ctx_ a decoder for [params], flushing and reusing the
+     * open one when the parameters match.
+     * @returns false if no decoder could be opened.
+     * */
+    bool open_decoder(const AVCodecParameters *params, const AVCodec *codec);
+
+    /**
+     * @def
+     * Get the packet, frame, rgb buffer, export ring and window ready
+     * for the video in [state], on the calling (playback) thread.
+     * */
+    bool prepare_output(PlaybackState& state);
+
+    /**
+     * @def
+     * Free everything kept for reuse between loads.
+     * */
+    void release_resources();
+
+    /**
+     * @def
+     * Set up the next pass over the video: where it starts, whether it
+     * is read from the file or from the packet cache, and whether it
+     * fills the cache.
+     * @returns false if playback is over.
+     * */
+    bool begin_pass(PlaybackState& state, bool first);
+
+    /**
+     * @def
+     * Get the next packet of the pass into [packet].
+     * @returns false at the end of the pass.
+     * */
+    bool next_packet(PlaybackState& state, AVPacket *packet);
+
+    /**
+     * @def
+     * Send [packet] to the decoder (nullptr drains it) and present
+     * the frames that come out.
+     * */
+    void decode_packet(PlaybackState& state, AVPacket *packet);
+    void present_frame(PlaybackState& state, AVFrame *frame);
 
     friend void * play_video_thread (void* params);
 };
@@ -0,0 +1,213 @@
+#include "thread_policy.h"
+
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace {
+
+// from <numaif.h>, which needs libnuma's headers
+const int MPOL_PREFERRED_ {1};
+
+const char *role_names[THREAD_ROLE_COUNT] = {
+    "demux", "decode", "convert", "render", "audio", "analysis"
+};
+
+const char * sched_policy_name (int policy) {
+    switch (policy) {
+        case SCHED_FIFO: return "fifo";
+        case SCHED_RR: return "rr";
+        default: return "other";
+    }
+}
+
+std::string format_cpu_list (const std::vector<int>& cpus) {
+    std::string list;
+    size_t i {0};
+    while (i < cpus.size()) {
+        size_t j {i};
+        while (j+1 < cpus.size() && cpus[j+1] == cpus[j] + 1) ++j;
+
+        if (!list.empty()) list += ",";
+        list += std::to_string(cpus[i]);
+        if (j > i) list += "-" + std::to_string(cpus[j]);
+        i = j+1;
+    }
+    return list;
+}
+
+}
+
+const char * thread_role_name (THREAD_ROLE role) {
+    if (role < 0 || role >= THREAD_ROLE_COUNT) return "unknown";
+    return role_names[role];
+}
+
+bool parse_thread_role (const std::string& name, THREAD_ROLE& role) {
+    for (int i = 0; i < THREAD_ROLE_COUNT; ++i) {
+        if (name.compare(role_names[i]) == 0) {
+            role = (THREAD_ROLE) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parse_cpu_list (const std::string& list, std::vector<int>& cpus) {
+    std::vector<int> parsed;
+    const char *p = list.c_str();
+
+    while (*p != '\0') {
+        char *end {nullptr};
+        long first = strtol(p, &end, 10);
+        if (end == p || first < 0 || first >= CPU_SETSIZE) return false;
+
+        long last {first};
+        p = end;
+        if (*p == '-') {
+            ++p;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first || last >= CPU_SETSIZE) return false;
+            p = end;
+        }
+
+        for (long cpu = first; cpu <= last; ++cpu) parsed.push_back((int) cpu);
+
+        if (*p == ',') ++p;
+        else if (*p != '\0' && *p != '\n') return false;
+        else break;
+    }
+
+    if (parsed.empty()) return false;
+    cpus = parsed;
+    return true;
+}
+
+bool parse_sched_policy (const std::string& name, int& policy) {
+    if (name.compare("other") == 0) policy = SCHED_OTHER;
+    else if (name.compare("fifo") == 0) policy = SCHED_FIFO;
+    else if (name.compare("rr") == 0) policy = SCHED_RR;
+    else return false;
+    return true;
+}
+
+std::vector<int> numa_node_cpus (int node) {
+    std::vector<int> cpus;
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+
+    FILE *f = fopen(path, "r");
+    if (f == nullptr) return cpus;
+
+    char line[1024];
+    if (fgets(line, sizeof(line), f) != nullptr) {
+        parse_cpu_list(line, cpus);
+    }
+    fclose(f);
+    return cpus;
+}
+
+std::string describe_thread_policy (const ThreadPolicy& policy) {
+    std::string desc = "cpus=";
+    desc += policy.cpus.empty() ? "inherit" : format_cpu_list(policy.cpus);
+    desc += " numa=";
+    desc += policy.numa_node < 0 ? "any" : std::to_string(policy.numa_node);
+    desc += " sched=";
+    desc += sched_policy_name(policy.sched_policy);
+    if (policy.sched_policy != SCHED_OTHER) {
+        desc += "/" + std::to_string(policy.sched_priority);
+    }
+    return desc;
+}
+
+void apply_thread_policy (THREAD_ROLE role, const ThreadPolicy& policy) {
+    pthread_t self = pthread_self();
+
+    // thread names are limited to 16 bytes including the terminator
+    char name[16];
+    snprintf(name, sizeof(name), "vp-%s", thread_role_name(role));
+    pthread_setname_np(self, name);
+
+    std::vector<int> cpus = policy.cpus;
+    if (cpus.empty() && policy.numa_node >= 0) {
+        cpus = numa_node_cpus(policy.numa_node);
+        if (cpus.empty()) {
+            fprintf(stderr, "Warning: [%s] NUMA node %d not found.\n",
+                name, policy.numa_node);
+        }
+    }
+
+    if (!cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) CPU_SET(cpu, &set);
+
+        int res = pthread_setaffinity_np(self, sizeof(set), &set);
+        if (res != 0) {
+            fprintf(stderr, "Warning: [%s] Failed to set cpu affinity (%s).\n",
+                name, strerror(res));
+        }
+    }
+
+    if (policy.numa_node >= 0 && policy.numa_node < (int) (8 * sizeof(unsigned long))) {
+        unsigned long node_mask = 1UL << policy.numa_node;
+        if (syscall(SYS_set_mempolicy, MPOL_PREFERRED_, &node_mask,
+                8 * sizeof(node_mask)) != 0) {
+            fprintf(stderr, "Warning: [%s] Failed to prefer NUMA node %d (%s).\n",
+                name, policy.numa_node, strerror(errno));
+        }
+    }
+
+    if (policy.sched_policy != SCHED_OTHER) {
+        struct sched_param param;
+        param.sched_priority = policy.sched_priority;
+
+        int min_prio = sched_get_priority_min(policy.sched_policy);
+        int max_prio = sched_get_priority_max(policy.sched_policy);
+        if (param.sched_priority < min_prio) param.sched_priority = min_prio;
+        if (param.sched_priority > max_prio) param.sched_priority = max_prio;
+
+        int res = pthread_setschedparam(self, policy.sched_policy, &param);
+        if (res == EPERM) {
+            fprintf(stderr, "Warning: [%s] Not permitted to use real-time "
+                "scheduling (needs CAP_SYS_NICE or RLIMIT_RTPRIO). "
+                "Keeping default scheduling.\n", name);
+        } else if (res != 0) {
+            fprintf(stderr, "Warning: [%s] Failed to set scheduling policy (%s).\n",
+                name, strerror(res));
+        }
+    }
+
+    // report what the thread actually ended up with
+    ThreadPolicy applied;
+    applied.numa_node = policy.numa_node;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(self, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) applied.cpus.push_back(cpu);
+        }
+    }
+
+    struct sched_param param;
+    if (pthread_getschedparam(self, &applied.sched_policy, &param) == 0) {
+        applied.sched_priority = param.sched_priority;
+    }
+
+    printf("Thread [%s] placement: %s (running on cpu %d)\n",
+        name, describe_thread_policy(applied).c_str(), sched_getcpu());
+}
+
+void touch_pages (void *buff, size_t size) {
+    if (buff == nullptr) return;
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (page_size <= 0) page_size = 4096;
+
+    volatile uint8_t *bytes = (volatile uint8_t *) buff;
+    for (size_t i = 0; i < size; i += page_size) bytes[i] = 0;
+    if (size > 0) bytes[size-1] = 0;
+}
@@ -0,0 +1,103 @@
+#ifndef _THREAD_POLICY_H_
+#define _THREAD_POLICY_H_
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+#include <pthread.h>
+#include <sched.h>
+
+/**
+ * @def
+ * The roles a player thread can take. Every role has its own
+ * placement policy so that e.g. the decoder can be pinned apart
+ * from the render thread.
+ * */
+enum THREAD_ROLE
+{
+    ROLE_DEMUX,
+    ROLE_DECODE,
+    ROLE_CONVERT,
+    ROLE_RENDER,
+    ROLE_AUDIO,
+    ROLE_ANALYSIS,
+    THREAD_ROLE_COUNT
+};
+
+/**
+ * @def
+ * Placement of a single thread.
+ * cpus: cpus the thread may run on. Empty => inherit from the creator
+ *  (or the cpus of [numa_node] when one is set).
+ * numa_node: node to prefer for the thread's memory allocations.
+ *  -1 => no preference.
+ * sched_policy: SCHED_OTHER, SCHED_FIFO or SCHED_RR.
+ * sched_priority: real-time priority, only used for SCHED_FIFO/SCHED_RR.
+ * */
+struct ThreadPolicy {
+    std::vector<int> cpus;
+    int numa_node = -1;
+    int sched_policy = SCHED_OTHER;
+    int sched_priority = 0;
+};
+
+/**
+ * @def
+ * Short name of the role ("demux", "decode", ...).
+ * */
+const char * thread_role_name (THREAD_ROLE role);
+
+/**
+ * @def
+ * Parse [name] into a role.
+ * @returns false if [name] is not a known role.
+ * */
+bool parse_thread_role (const std::string& name, THREAD_ROLE& role);
+
+/**
+ * @def
+ * Parse a cpu list in the kernel's format (e.g. "0-3,8,10-11")
+ * into [cpus].
+ * @returns false if the list is malformed.
+ * */
+bool parse_cpu_list (const std::string& list, std::vector<int>& cpus);
+
+/**
+ * @def
+ * Parse "other", "fifo" or "rr" into a SCHED_* policy.
+ * */
+bool parse_sched_policy (const std::string& name, int& policy);
+
+/**
+ * @def
+ * Cpus that belong to NUMA node [node], read from sysfs.
+ * Empty if the node does not exist.
+ * */
+std::vector<int> numa_node_cpus (int node);
+
+/**
+ * @def
+ * Human readable one-line description of [policy].
+ * */
+std::string describe_thread_policy (const ThreadPolicy& policy);
+
+/**
+ * @def
+ * Apply [policy] to the calling thread and name it after [role] so it
+ * shows up in top/perf. Failures (e.g. no permission for real-time
+ * scheduling) are reported and the thread keeps its defaults.
+ * The placement that ended up being applied is printed.
+ * */
+void apply_thread_policy (THREAD_ROLE role, const ThreadPolicy& policy);
+
+/**
+ * @def
+ * Write to every page of [buff] from the calling thread so the kernel
+ * backs the pages with memory local to the node the thread runs on
+ * (first-touch placement).
+ * */
+void touch_pages (void *buff, size_t size);
+
+#endif
@@ -0,0 +1,201 @@
+#include "shm_ring.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+namespace {
+
+// the ring is shared between processes, so the futex
+// calls can't use the FUTEX_PRIVATE_FLAG variants
+long futex (std::atomic<uint32_t> *addr, int op, uint32_t val,
+    const struct timespec *timeout) {
+    return syscall(SYS_futex, (uint32_t *) addr, op, val, timeout, nullptr, 0);
+}
+
+}
+
+void shm_ring_notify (ShmRingHeader *header) {
+    // the bump of notify must be visible before waiters is read and a
+    // reader's waiters increment before it waits on notify, otherwise
+    // both sides can miss each other and the wake-up is lost. Only
+    // seq_cst orders a store before a later load.
+    header->notify.fetch_add(1, std::memory_order_seq_cst);
+    // skip the syscall when nobody is waiting
+    if (header->waiters.load(std::memory_order_seq_cst) > 0) {
+        futex(&header->notify, FUTEX_WAKE, INT_MAX, nullptr);
+    }
+}
+
+ShmFrameReader::~ShmFrameReader() {
+    close();
+}
+
+bool ShmFrameReader::open(const std::string& name) {
+    close();
+
+    std::string shm_name = name[0] == '/' ? name : "/" + name;
+    int fd = shm_open(shm_name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Failed to open shared memory [%s].\n", shm_name.c_str());
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(ShmRingHeader)) {
+        fprintf(stderr, "Error: Shared memory [%s] is not a frame ring.\n", shm_name.c_str());
+        ::close(fd);
+        return false;
+    }
+
+    void *mem = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        fprintf(stderr, "Error: Failed to map shared memory [%s].\n", shm_name.c_str());
+        return false;
+    }
+
+    base_ = (uint8_t *) mem;
+    size_ = st.st_size;
+    header_ = (ShmRingHeader *) base_;
+
+    if (header_->magic != SHM_RING_MAGIC || header_->version != SHM_RING_VERSION
+        || header_->slot_count == 0
+        || sizeof(ShmRingHeader) + header_->slot_count * header_->slot_stride > size_) {
+        fprintf(stderr, "Error: Shared memory [%s] is not a frame ring.\n", shm_name.c_str());
+        close();
+        return false;
+    }
+
+    // register so the writer can tell how far behind we are
+    for (int i = 0; i < SHM_RING_MAX_READERS; ++i) {
+        uint32_t free_pid {0};
+        if (header_->readers[i].pid.compare_exchange_strong(free_pid, (uint32_t) getpid())) {
+            entry_ = &header_->readers[i];
+            break;
+        }
+    }
+
+    cursor_ = header_->write_seq.load(std::memory_order_acquire);
+    if (cursor_ > 0) --cursor_;
+    if (entry_ != nullptr) entry_->cursor.store(cursor_, std::memory_order_relaxed);
+
+    frames_read_ = frames_skipped_ = 0;
+    return true;
+}
+
+void ShmFrameReader::close() {
+    if (entry_ != nullptr) {
+        entry_->pid.store(0, std::memory_order_release);
+        entry_ = nullptr;
+    }
+    if (base_ != nullptr) {
+        munmap(base_, size_);
+        base_ = nullptr;
+        size_ = 0;
+        header_ = nullptr;
+    }
+}
+
+ShmSlotHeader * ShmFrameReader::slot(uint64_t number) const {
+    return (ShmSlotHeader *) (base_ + sizeof(ShmRingHeader)
+        + (number % header_->slot_count) * header_->slot_stride);
+}
+
+SHM_READ_RESULT ShmFrameReader::next(ShmFrameView& view, int timeout_ms) {
+    if (header_ == nullptr) return SHM_READ_CLOSED;
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long) (timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    while (true) {
+        uint32_t notify = header_->notify.load(std::memory_order_acquire);
+        uint64_t written = header_->write_seq.load(std::memory_order_acquire);
+
+        if (written > cursor_) {
+            // the writer doesn't wait for us, frames older than a
+            // ring are gone. Jump to the newest one.
+            if (written - cursor_ >= header_->slot_count) {
+                frames_skipped_ += written - 1 - cursor_;
+                cursor_ = written - 1;
+            }
+
+            ShmSlotHeader *s = slot(cursor_);
+            uint64_t seq = s->seq.load(std::memory_order_acquire);
+            if (seq != 2 * cursor_ + 2) {
+                // overwritten since we loaded write_seq
+                ++frames_skipped_;
+                ++cursor_;
+                continue;
+            }
+
+            const uint8_t *data = (const uint8_t *) s + header_->data_offset;
+            view.number = cursor_;
+            view.pts = s->pts;
+            view.time_base_num = s->time_base_num;
+            view.time_base_den = s->time_base_den;
+            view.format = s->format;
+            view.width = s->width;
+            view.height = s->height;
+            view.data_size = s->data_size;
+            for (int i = 0; i < 4; ++i) {
+                view.linesize[i] = s->linesize[i];
+                view.data[i] = s->linesize[i] > 0 ? data + s->plane_offset[i] : nullptr;
+            }
+
+            ++cursor_;
+            ++frames_read_;
+            if (entry_ != nullptr) entry_->cursor.store(cursor_, std::memory_order_relaxed);
+
+            if (!still_valid(view)) {
+                --frames_read_;
+                ++frames_skipped_;
+                continue;
+            }
+            return SHM_READ_FRAME;
+        }
+
+        // close() bumps notify after setting it, so a wait below
+        // can't miss it.
+        if (header_->closed.load(std::memory_order_acquire) != 0) {
+            // the last frames may have been committed between the
+            // load of write_seq above and the close, read them first
+            if (header_->write_seq.load(std::memory_order_acquire) > cursor_) continue;
+            return SHM_READ_CLOSED;
+        }
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        struct timespec timeout;
+        timeout.tv_sec = deadline.tv_sec - now.tv_sec;
+        timeout.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+        if (timeout.tv_nsec < 0) {
+            timeout.tv_sec -= 1;
+            timeout.tv_nsec += 1000000000L;
+        }
+        if (timeout.tv_sec < 0) return SHM_READ_TIMEOUT;
+
+        header_->waiters.fetch_add(1, std::memory_order_seq_cst);
+        futex(&header_->notify, FUTEX_WAIT, notify, &timeout);
+        header_->waiters.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+bool ShmFrameReader::still_valid(const ShmFrameView& view) const {
+    if (header_ == nullptr) return false;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot(view.number)->seq.load(std::memory_order_relaxed) == 2 * view.number + 2;
+}
@@ -0,0 +1,173 @@
+#ifndef _SHM_RING_H_
+#define _SHM_RING_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+/**
+ * Layout of the shared-memory frame ring written by ShmFrameSink.
+ *
+ * The segment starts with a ShmRingHeader followed by [slot_count]
+ * slots of [slot_stride] bytes. Every slot starts with a ShmSlotHeader,
+ * the frame's planes follow at [data_offset] from the slot start.
+ *
+ * There is one writer and any number of readers. The writer never
+ * waits for readers: frame n always goes to slot n % slot_count.
+ * Every slot is a seqlock, [seq] is odd while the slot is being
+ * written and 2n+2 once frame n is complete, so readers can read the
+ * planes in place and afterwards check that they weren't overwritten.
+ *
+ * When the writer closes the ring (stops, exits or replaces it with a
+ * new one for another frame size) it sets [closed] and wakes readers.
+ * The segment is already unlinked by then, readers have to reopen the
+ * name to get the new ring.
+ * */
+
+#define SHM_RING_MAGIC 0x52465056u /* "VPFR" */
+#define SHM_RING_VERSION 2u
+#define SHM_RING_MAX_READERS 16
+
+struct ShmReaderEntry {
+    /**
+     * @def
+     * pid of the reader using this entry, 0 => free.
+     * */
+    std::atomic<uint32_t> pid;
+    /**
+     * @def
+     * Number of the next frame the reader wants.
+     * */
+    std::atomic<uint64_t> cursor;
+};
+
+struct ShmRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t data_offset;
+    uint64_t slot_stride;
+
+    /**
+     * @def
+     * Number of frames published so far.
+     * */
+    std::atomic<uint64_t> write_seq;
+    /**
+     * @def
+     * Futex word, bumped after every publish. Readers with nothing to
+     * read wait on it.
+     * */
+    std::atomic<uint32_t> notify;
+    std::atomic<uint32_t> waiters;
+    /**
+     * @def
+     * 1 => the writer is gone and won't publish into this ring again.
+     * */
+    std::atomic<uint32_t> closed;
+
+    ShmReaderEntry readers[SHM_RING_MAX_READERS];
+};
+
+struct ShmSlotHeader {
+    std::atomic<uint64_t> seq;
+    int64_t pts;
+    int32_t time_base_num, time_base_den;
+    /**
+     * @def
+     * AVPixelFormat of the planes.
+     * */
+    int32_t format;
+    int32_t width, height;
+    int32_t linesize[4];
+    uint32_t plane_offset[4];
+    uint32_t data_size;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+    "ring counters must be lock free to be shared between processes");
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+    "ring counters must be lock free to be shared between processes");
+
+/**
+ * @def
+ * A frame read from the ring. The plane pointers point straight into
+ * the shared mapping.
+ * */
+struct ShmFrameView {
+    uint64_t number;
+    int64_t pts;
+    int32_t time_base_num, time_base_den;
+    int32_t format;
+    int32_t width, height;
+    const uint8_t *data[4];
+    int32_t linesize[4];
+    uint32_t data_size;
+};
+
+enum SHM_READ_RESULT {
+    SHM_READ_FRAME,
+    SHM_READ_TIMEOUT,
+    /**
+     * @def
+     * The writer closed the ring and every frame was read. Reopen it
+     * to follow the writer's next ring.
+     * */
+    SHM_READ_CLOSED
+};
+
+/**
+ * @def
+ * Wake readers waiting on [header]'s futex.
+ * */
+void shm_ring_notify (ShmRingHeader *header);
+
+class ShmFrameReader {
+
+public:
+    ShmFrameReader() = default;
+    ShmFrameReader(const ShmFrameReader &r) = delete;
+    ~ShmFrameReader();
+
+    void operator=(const ShmFrameReader &r) = delete;
+
+    /**
+     * @def
+     * Map the ring published under [name] and start reading at the
+     * newest frame.
+     * */
+    bool open(const std::string& name);
+    void close();
+
+    /**
+     * @def
+     * Get the next frame, waiting up to [timeout_ms] for the writer.
+     * If the reader fell more than a ring behind it skips ahead to the
+     * newest frame. The view is only good until the writer wraps
+     * around, check it with still_valid once done with it.
+     * */
+    SHM_READ_RESULT next(ShmFrameView& view, int timeout_ms);
+
+    /**
+     * @def
+     * true => [view] was not overwritten while it was being read.
+     * */
+    bool still_valid(const ShmFrameView& view) const;
+
+    uint64_t frames_read() const { return frames_read_; }
+    uint64_t frames_skipped() const { return frames_skipped_; }
+
+private:
+    uint8_t *base_ = nullptr;
+    size_t size_ = 0;
+    ShmRingHeader *header_ = nullptr;
+    ShmReaderEntry *entry_ = nullptr;
+    uint64_t cursor_ = 0;
+    uint64_t frames_read_ = 0;
+    uint64_t frames_skipped_ = 0;
+
+    ShmSlotHeader * slot(uint64_t number) const;
+};
+
+#endif
@@ -0,0 +1,247 @@
+#include "shm_sink.h"
+
+#include <new>
+#include <cerrno>
+#include <climits>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+namespace {
+
+const size_t SLOT_ALIGN {64};
+
+size_t align_up (size_t size, size_t align) {
+    return (size + align - 1) / align * align;
+}
+
+const int MAX_OPEN_RINGS {8};
+
+/**
+ * @def
+ * Rings open in this process, for shm_sink_close_all. The name is
+ * written before the header is published, whoever takes the header
+ * out of the entry closes the ring.
+ * */
+struct OpenRing {
+    std::atomic<ShmRingHeader *> header;
+    char name[NAME_MAX + 1];
+};
+
+OpenRing open_rings[MAX_OPEN_RINGS];
+
+void register_ring (ShmRingHeader *header, const std::string& name) {
+    for (auto& ring : open_rings) {
+        if (ring.header.load(std::memory_order_acquire) != nullptr) continue;
+        snprintf(ring.name, sizeof(ring.name), "%s", name.c_str());
+        ShmRingHeader *empty {nullptr};
+        if (ring.header.compare_exchange_strong(empty, header)) return;
+    }
+    fprintf(stderr, "Warning: Too many open frame rings, [%s] may outlive "
+        "the process if it is killed.\n", name.c_str());
+}
+
+/**
+ * @returns false if shm_sink_close_all already closed the ring.
+ * */
+bool unregister_ring (ShmRingHeader *header) {
+    for (auto& ring : open_rings) {
+        ShmRingHeader *expected {header};
+        if (ring.header.compare_exchange_strong(expected, nullptr)) return true;
+    }
+    return false;
+}
+
+}
+
+ShmFrameSink::~ShmFrameSink() {
+    close();
+}
+
+bool ShmFrameSink::open(const std::string& name, int slot_count,
+    int width, int height, AVPixelFormat format) {
+    close();
+
+    if (slot_count < 2) {
+        fprintf(stderr, "Error: The frame ring needs at least 2 slots.\n");
+        return false;
+    }
+
+    // planes are packed without padding, so a row is exactly
+    // linesize bytes for readers and for the window upload
+    if (av_image_fill_linesizes(linesize_, format, width) < 0) {
+        fprintf(stderr, "Error: Unsupported frame layout for export.\n");
+        return false;
+    }
+    int size = av_image_get_buffer_size(format, width, height, 1);
+    if (size < 0) {
+        fprintf(stderr, "Error: Unsupported frame layout for export.\n");
+        return false;
+    }
+    data_size_ = size;
+
+    uint8_t *planes[4] = {nullptr};
+    av_image_fill_pointers(planes, format, height, nullptr, linesize_);
+    for (int i = 0; i < 4; ++i) {
+        plane_offset_[i] = (uint32_t) (uintptr_t) planes[i];
+    }
+
+    const size_t data_offset = align_up(sizeof(ShmSlotHeader), SLOT_ALIGN);
+    const size_t slot_stride = align_up(data_offset + data_size_, SLOT_ALIGN);
+    size_ = sizeof(ShmRingHeader) + slot_count * slot_stride;
+
+    name_ = name[0] == '/' ? name : "/" + name;
+    shm_unlink(name_.c_str());
+    int fd = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Failed to create shared memory [%s].\n", name_.c_str());
+        return false;
+    }
+
+    if (ftruncate(fd, size_) != 0) {
+        fprintf(stderr, "Error: Failed to size shared memory [%s].\n", name_.c_str());
+        ::close(fd);
+        shm_unlink(name_.c_str());
+        return false;
+    }
+
+    void *mem = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        fprintf(stderr, "Error: Failed to map shared memory [%s].\n", name_.c_str());
+        shm_unlink(name_.c_str());
+        return false;
+    }
+    base_ = (uint8_t *) mem;
+
+    // ftruncate zero fills, placement new only sets up the atomics
+    ShmRingHeader *header = new (base_) ShmRingHeader;
+    header->slot_count = slot_count;
+    header->data_offset = data_offset;
+    header->slot_stride = slot_stride;
+    header->write_seq.store(0, std::memory_order_relaxed);
+    header->notify.store(0, std::memory_order_relaxed);
+    header->waiters.store(0, std::memory_order_relaxed);
+    header->closed.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < SHM_RING_MAX_READERS; ++i) {
+        header->readers[i].pid.store(0, std::memory_order_relaxed);
+        header->readers[i].cursor.store(0, std::memory_order_relaxed);
+    }
+
+    for (int i = 0; i < slot_count; ++i) {
+        auto *slot = new (base_ + sizeof(ShmRingHeader) + i * slot_stride) ShmSlotHeader;
+        slot->seq.store(0, std::memory_order_relaxed);
+    }
+
+    header->version = SHM_RING_VERSION;
+    // readers check the magic last
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = SHM_RING_MAGIC;
+
+    header_ = header;
+    register_ring(header_, name_);
+    width_ = width;
+    height_ = height;
+    format_ = format;
+
+    printf("Exporting frames to shared memory [%s]: %d slots of %ux%u (%u bytes).\n",
+        name_.c_str(), slot_count, width, height, data_size_);
+    return true;
+}
+
+void ShmFrameSink::close() {
+    if (base_ != nullptr) {
+        if (unregister_ring(header_)) {
+            // readers keep the segment mapped after the unlink,
+            // tell them it is orphaned
+            header_->closed.store(1, std::memory_order_seq_cst);
+            shm_ring_notify(header_);
+            shm_unlink(name_.c_str());
+        }
+
+        munmap(base_, size_);
+        base_ = nullptr;
+        header_ = nullptr;
+        current_ = nullptr;
+        size_ = 0;
+    }
+}
+
+void ShmFrameSink::begin_frame(uint8_t *data[4], int linesize[4]) {
+    const uint64_t number = header_->write_seq.load(std::memory_order_relaxed);
+    current_ = (ShmSlotHeader *) (base_ + sizeof(ShmRingHeader)
+        + (number % header_->slot_count) * header_->slot_stride);
+
+    // odd => slot is being written, readers holding it will notice
+    current_->seq.store(2 * number + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint8_t *slot_data = (uint8_t *) current_ + header_->data_offset;
+    for (int i = 0; i < 4; ++i) {
+        linesize[i] = linesize_[i];
+        data[i] = linesize_[i] > 0 ? slot_data + plane_offset_[i] : nullptr;
+    }
+}
+
+void ShmFrameSink::commit_frame(int64_t pts, AVRational time_base) {
+    if (current_ == nullptr) return;
+
+    const uint64_t number = header_->write_seq.load(std::memory_order_relaxed);
+    current_->pts = pts;
+    current_->time_base_num = time_base.num;
+    current_->time_base_den = time_base.den;
+    current_->format = format_;
+    current_->width = width_;
+    current_->height = height_;
+    current_->data_size = data_size_;
+    for (int i = 0; i < 4; ++i) {
+        current_->linesize[i] = linesize_[i];
+        current_->plane_offset[i] = plane_offset_[i];
+    }
+
+    current_->seq.store(2 * number + 2, std::memory_order_release);
+    header_->write_seq.store(number + 1, std::memory_order_release);
+    current_ = nullptr;
+
+    shm_ring_notify(header_);
+
+    if ((number + 1) % header_->slot_count == 0) check_readers(number + 1);
+}
+
+uint64_t ShmFrameSink::frames_published() const {
+    if (header_ == nullptr) return 0;
+    return header_->write_seq.load(std::memory_order_relaxed);
+}
+
+void ShmFrameSink::check_readers(uint64_t written) {
+    for (int i = 0; i < SHM_RING_MAX_READERS; ++i) {
+        uint32_t pid = header_->readers[i].pid.load(std::memory_order_acquire);
+        if (pid == 0) continue;
+
+        // free the entries of readers that died without closing
+        if (kill((pid_t) pid, 0) != 0 && errno == ESRCH) {
+            header_->readers[i].pid.compare_exchange_strong(pid, 0);
+            continue;
+        }
+
+        // only warn once per reader, a slow reader stays slow
+        uint64_t cursor = header_->readers[i].cursor.load(std::memory_order_relaxed);
+        if (cursor + header_->slot_count < written && warned_pid_[i] != pid) {
+            fprintf(stderr, "Warning: Export reader (pid=%u) is %lu frames behind, "
+                "it will skip ahead.\n", pid, (unsigned long) (written - cursor));
+            warned_pid_[i] = pid;
+        }
+    }
+}
+
+void shm_sink_close_all () {
+    for (auto& ring : open_rings) {
+        ShmRingHeader *header = ring.header.exchange(nullptr);
+        if (header == nullptr) continue;
+
+        header->closed.store(1, std::memory_order_seq_cst);
+        shm_ring_notify(header);
+        shm_unlink(ring.name);
+    }
+}
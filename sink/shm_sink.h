@@ -0,0 +1,91 @@
+#ifndef _SHM_SINK_H_
+#define _SHM_SINK_H_
+
+#include <string>
+#include <cstdint>
+#include <cstdio>
+
+#include <ffmpeg_extern.h>
+#include "shm_ring.h"
+
+/**
+ * @def
+ * Publishes frames into a POSIX shared-memory ring (see shm_ring.h)
+ * so other local processes can map the frames the player shows
+ * instead of decoding the file a second time.
+ *
+ * The player converts straight into the slot returned by begin_frame,
+ * so the frame is only written once for both the window and readers.
+ * */
+class ShmFrameSink {
+
+public:
+    ShmFrameSink() = default;
+    ShmFrameSink(const ShmFrameSink &s) = delete;
+    ~ShmFrameSink();
+
+    void operator=(const ShmFrameSink &s) = delete;
+
+    /**
+     * @def
+     * Create the ring [name] with [slot_count] slots, each holding a
+     * [width]x[height] image in [format]. An existing ring with the
+     * same name is replaced.
+     * */
+    bool open(const std::string& name, int slot_count,
+        int width, int height, AVPixelFormat format);
+    void close();
+
+    bool ok() const { return header_ != nullptr; }
+    const std::string& name() const { return name_; }
+    int slot_count() const { return header_ == nullptr ? 0 : header_->slot_count; }
+    int width() const { return width_; }
+    int height() const { return height_; }
+    AVPixelFormat format() const { return format_; }
+
+    /**
+     * @def
+     * Get the planes of the next slot to write the frame into. Must be
+     * followed by commit_frame.
+     * */
+    void begin_frame(uint8_t *data[4], int linesize[4]);
+
+    /**
+     * @def
+     * Publish the frame written since begin_frame and wake readers.
+     * */
+    void commit_frame(int64_t pts, AVRational time_base);
+
+    uint64_t frames_published() const;
+
+private:
+    std::string name_;
+    uint8_t *base_ = nullptr;
+    size_t size_ = 0;
+    ShmRingHeader *header_ = nullptr;
+    ShmSlotHeader *current_ = nullptr;
+
+    int width_ = 0, height_ = 0;
+    AVPixelFormat format_ = AV_PIX_FMT_NONE;
+    int linesize_[4] = {0};
+    uint32_t plane_offset_[4] = {0};
+    uint32_t data_size_ = 0;
+    uint32_t warned_pid_[SHM_RING_MAX_READERS] = {0};
+
+    /**
+     * @def
+     * Log readers that fell more than a ring behind. They skip ahead
+     * on their own, the writer never waits for them.
+     * */
+    void check_readers(uint64_t written);
+};
+
+/**
+ * @def
+ * Mark every open ring closed, wake its readers and unlink it. Safe to
+ * call from a signal handler, so rings don't outlive a process killed
+ * with SIGINT/SIGTERM in /dev/shm. The mappings go with the process.
+ * */
+void shm_sink_close_all ();
+
+#endif
@@ -0,0 +1,120 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "../player/packet_cache.h"
+
+/**
+ * Checks the loop packet cache on a small synthetic segment: a cap far
+ * below one chunk must still hold a small segment, cached packets must
+ * come back with their data, timestamps and side data, a segment over
+ * the cap must overflow, and passes must start at the right key frame.
+ *
+ * Usage: packet_cache_test
+ * Exits with EXIT_FAILURE on failure.
+ * */
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "FAIL: %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            return false; \
+        } \
+    } while (0)
+
+const int PACKETS {20};
+const int PACKET_SIZE {1000};
+const int GOP {10};
+const int SIDE_DATA_PACKET {5};
+const int SIDE_DATA_SIZE {1024};
+
+bool fill_packet (AVPacket *packet, int i) {
+    // a failed check may have left the last packet behind
+    av_packet_unref(packet);
+    if (av_new_packet(packet, PACKET_SIZE) < 0) return false;
+    memset(packet->data, i, PACKET_SIZE);
+    packet->pts = packet->dts = i;
+    packet->duration = 1;
+    packet->flags = i % GOP == 0 ? AV_PKT_FLAG_KEY : 0;
+
+    if (i == SIDE_DATA_PACKET) {
+        uint8_t *palette = av_packet_new_side_data(packet, AV_PKT_DATA_PALETTE, SIDE_DATA_SIZE);
+        if (palette == nullptr) return false;
+        memset(palette, 0xab, SIDE_DATA_SIZE);
+    }
+    return true;
+}
+
+bool small_cap_holds_small_segment (AVPacket *packet) {
+    // 64 KB, a fraction of one chunk
+    const size_t cap {64 << 10};
+    PacketCache cache;
+    cache.reset(cap, 0, PACKETS);
+
+    for (int i = 0; i < PACKETS; ++i) {
+        CHECK(fill_packet(packet, i));
+        CHECK(cache.add(packet));
+        av_packet_unref(packet);
+    }
+    cache.mark_complete();
+
+    CHECK(cache.complete());
+    CHECK(!cache.overflowed());
+    CHECK(cache.size() == (size_t) PACKETS);
+    CHECK(cache.bytes() <= cap);
+
+    for (int i = 0; i < PACKETS; ++i) {
+        CHECK(cache.get(i, packet));
+        CHECK(packet->size == PACKET_SIZE);
+        CHECK(packet->data[0] == i && packet->data[PACKET_SIZE - 1] == i);
+        CHECK(packet->pts == i && packet->dts == i);
+        CHECK(((packet->flags & AV_PKT_FLAG_KEY) != 0) == (i % GOP == 0));
+
+        size_t size {0};
+        const uint8_t *palette = av_packet_get_side_data(packet, AV_PKT_DATA_PALETTE, &size);
+        if (i == SIDE_DATA_PACKET) {
+            CHECK(palette != nullptr && size == (size_t) SIDE_DATA_SIZE);
+            CHECK(palette[0] == 0xab && palette[SIDE_DATA_SIZE - 1] == 0xab);
+        } else {
+            CHECK(palette == nullptr);
+        }
+        av_packet_unref(packet);
+    }
+    CHECK(!cache.get(PACKETS, packet));
+
+    CHECK(cache.seek_point(0) == 0);
+    CHECK(cache.seek_point(GOP - 1) == 0);
+    CHECK(cache.seek_point(GOP + 5) == (size_t) GOP);
+    return true;
+}
+
+bool large_segment_overflows (AVPacket *packet) {
+    // room for a few packets only
+    PacketCache cache;
+    cache.reset(4 * PACKET_SIZE, 0, PACKETS);
+
+    bool added {true};
+    for (int i = 0; i < PACKETS && added; ++i) {
+        CHECK(fill_packet(packet, i));
+        added = cache.add(packet);
+        av_packet_unref(packet);
+    }
+    cache.mark_complete();
+
+    CHECK(!added);
+    CHECK(cache.overflowed());
+    CHECK(!cache.complete());
+    CHECK(cache.size() == 0 && cache.bytes() == 0);
+    return true;
+}
+
+int main () {
+    AVPacket *packet = av_packet_alloc();
+    if (packet == nullptr) return EXIT_FAILURE;
+
+    bool ok = small_cap_holds_small_segment(packet);
+    ok = large_segment_overflows(packet) && ok;
+
+    av_packet_free(&packet);
+    fprintf(stderr, "%s: packet cache\n", ok ? "PASS" : "FAIL");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,95 @@
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+
+#include "../util.h"
+#include "../player/player.h"
+
+/**
+ * Loads, plays and stops a clip over and over in a headless player and
+ * checks that the process doesn't grow: the decoder, scaler and frame
+ * buffers are recycled between loads, so after the first cycles RSS
+ * must stay flat.
+ *
+ * Every cycle must convert at least one frame, a cycle that doesn't
+ * never exercised the recycled resources and fails the test. Growth is
+ * judged per measured cycle, so a small per-load leak fails however
+ * long the run is, on top of a fixed allowance for allocator noise.
+ *
+ * The player runs headless, so the window and its GL textures are
+ * never created: their recycling across loads is not covered here.
+ *
+ * Usage: soak_test <path_to_file> [cycles]
+ * Exits with EXIT_FAILURE on failure.
+ * */
+
+// frames to play per cycle before stopping, the rest of the
+// clip is cut off by the stop like a user would
+const uint64_t FRAMES_PER_CYCLE {8};
+const int CYCLE_TIMEOUT_MS {10000};
+const int DEFAULT_CYCLES {2000};
+// page granularity and allocator caches
+const long NOISE_KB {256};
+const long MAX_BYTES_PER_CYCLE {128};
+
+int main (int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <path_to_file> [cycles]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const int cycles = argc >= 3 ? atoi(argv[2]) : DEFAULT_CYCLES;
+    if (cycles <= 0) {
+        fprintf(stderr, "Error: Invalid number of cycles [%s].\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    // the first cycles build the decoder and buffers,
+    // growth is measured from after that
+    const int warmup = cycles < 10 ? 1 : cycles / 10;
+    long baseline_kb {-1};
+
+    Player player;
+    player.set_headless(true);
+
+    for (int i = 1; i <= cycles; ++i) {
+        const uint64_t before = player.frames_presented();
+        player.load_file(argv[1]);
+
+        auto start = std::chrono::steady_clock::now();
+        while (player.frames_presented() - before < FRAMES_PER_CYCLE && !player.finished()) {
+            if (std::chrono::steady_clock::now() - start
+                > std::chrono::milliseconds(CYCLE_TIMEOUT_MS)) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        player.stop();
+
+        const uint64_t frames = player.frames_presented() - before;
+        if (frames == 0) {
+            fprintf(stderr, "FAIL: cycle %d decoded no frames from [%s].\n", i, argv[1]);
+            return EXIT_FAILURE;
+        }
+
+        if (i == warmup) baseline_kb = current_rss_kb();
+        if (i == warmup || i % 100 == 0 || i == cycles) {
+            fprintf(stderr, "Soak: cycle %d/%d, %lu frames, rss %ld kB\n",
+                i, cycles, (unsigned long) frames, current_rss_kb());
+        }
+    }
+
+    const int measured = cycles - warmup;
+    const long growth_kb = current_rss_kb() - baseline_kb;
+    const long tolerance_kb = NOISE_KB + MAX_BYTES_PER_CYCLE * measured / 1024;
+    const long per_cycle = measured > 0 ? growth_kb * 1024 / measured : 0;
+    if (baseline_kb < 0 || growth_kb > tolerance_kb) {
+        fprintf(stderr, "FAIL: rss grew %ld kB over %d cycles after warm up, "
+            "%ld bytes per cycle (tolerance %ld kB).\n",
+            growth_kb, measured, per_cycle, tolerance_kb);
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stderr, "PASS: rss grew %ld kB over %d cycles after warm up, "
+        "%ld bytes per cycle.\n", growth_kb, measured, per_cycle);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,366 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+#include <ffmpeg_extern.h>
+
+/**
+ * Generates the synthetic test clips used by kernel_bench and for
+ * comparing player changes. Every clip is a deterministic pattern
+ * (gradients and a moving box) encoded with bit-exact flags, so two
+ * runs with the same libraries produce the same files.
+ *
+ * Usage: gen_media <output_dir>
+ * */
+
+struct ClipSpec {
+    const char *name;
+    int width, height;
+    AVPixelFormat pix_fmt;
+    int gop_size;
+    int max_b_frames;
+    int fps;
+    int frames;
+    /**
+     * @def
+     * true => frame durations cycle through 1, 1.5 and 0.5 frame times.
+     * */
+    bool vfr;
+    bool audio;
+};
+
+const ClipSpec CLIPS[] = {
+    {"360p_yuv420p_gop12",      640,  360, AV_PIX_FMT_YUV420P,    12, 2, 30, 150, false, false},
+    {"720p_nv12_gop30",        1280,  720, AV_PIX_FMT_NV12,       30, 0, 30, 120, false, false},
+    {"1080p_yuv420p_intra",    1920, 1080, AV_PIX_FMT_YUV420P,     1, 0, 25,  60, false, false},
+    {"1080p_yuv420p10_gop60",  1920, 1080, AV_PIX_FMT_YUV420P10,  60, 2, 30,  90, false, false},
+    {"720p_yuv420p_vfr_audio", 1280,  720, AV_PIX_FMT_YUV420P,    30, 2, 30, 150, true,  true},
+    {"2160p_yuv420p_gop30",    3840, 2160, AV_PIX_FMT_YUV420P,    30, 2, 30,  60, false, false},
+};
+
+// in order of preference, the first that takes the pixel format is used
+const char *VIDEO_ENCODERS[] = {"libx264", "libx265", "ffv1", "mpeg4", "rawvideo"};
+const char *AUDIO_ENCODERS[] = {"aac", "pcm_s16le"};
+
+const int VFR_DURATIONS[] = {2, 3, 1};
+const int AUDIO_RATE {48000};
+
+bool supports_pix_fmt (const AVCodec *codec, AVPixelFormat pix_fmt) {
+    if (codec->pix_fmts == nullptr) return true;
+    for (const AVPixelFormat *p = codec->pix_fmts; *p != AV_PIX_FMT_NONE; ++p) {
+        if (*p == pix_fmt) return true;
+    }
+    return false;
+}
+
+const AVCodec * find_video_encoder (AVPixelFormat pix_fmt) {
+    for (const char *name : VIDEO_ENCODERS) {
+        const AVCodec *codec = avcodec_find_encoder_by_name(name);
+        if (codec != nullptr && supports_pix_fmt(codec, pix_fmt)) return codec;
+    }
+    return nullptr;
+}
+
+/**
+ * @def
+ * Draw frame [index] of the pattern: diagonal luma gradient scrolling
+ * with time, a bright box moving across, chroma gradients.
+ * */
+void fill_video_frame (AVFrame *frame, int index) {
+    const int w {frame->width}, h {frame->height};
+    const int box = h / 6;
+    const int box_x = (index * 8) % (w > box ? w - box : 1);
+    const int box_y = h / 2 - box / 2;
+
+    auto luma = [&] (int x, int y) {
+        bool in_box = x >= box_x && x < box_x + box && y >= box_y && y < box_y + box;
+        return in_box ? 235 : 16 + ((x + y + index * 2) % 200);
+    };
+
+    if (frame->format == AV_PIX_FMT_YUV420P10) {
+        for (int y = 0; y < h; ++y) {
+            uint16_t *row = (uint16_t *) (frame->data[0] + (long) y * frame->linesize[0]);
+            // use the two extra bits so 10-bit paths see real 10-bit data
+            for (int x = 0; x < w; ++x) row[x] = luma(x, y) * 4 + (x & 3);
+        }
+        for (int y = 0; y < h / 2; ++y) {
+            uint16_t *u = (uint16_t *) (frame->data[1] + (long) y * frame->linesize[1]);
+            uint16_t *v = (uint16_t *) (frame->data[2] + (long) y * frame->linesize[2]);
+            for (int x = 0; x < w / 2; ++x) {
+                u[x] = 64 + (x * 896) / (w / 2);
+                v[x] = 64 + (y * 896) / (h / 2);
+            }
+        }
+        return;
+    }
+
+    for (int y = 0; y < h; ++y) {
+        uint8_t *row = frame->data[0] + (long) y * frame->linesize[0];
+        for (int x = 0; x < w; ++x) row[x] = luma(x, y);
+    }
+
+    for (int y = 0; y < h / 2; ++y) {
+        if (frame->format == AV_PIX_FMT_NV12) {
+            uint8_t *uv = frame->data[1] + (long) y * frame->linesize[1];
+            for (int x = 0; x < w / 2; ++x) {
+                uv[2*x] = 16 + (x * 224) / (w / 2);
+                uv[2*x+1] = 16 + (y * 224) / (h / 2);
+            }
+        } else {
+            uint8_t *u = frame->data[1] + (long) y * frame->linesize[1];
+            uint8_t *v = frame->data[2] + (long) y * frame->linesize[2];
+            for (int x = 0; x < w / 2; ++x) {
+                u[x] = 16 + (x * 224) / (w / 2);
+                v[x] = 16 + (y * 224) / (h / 2);
+            }
+        }
+    }
+}
+
+/**
+ * @def
+ * 440 Hz tone, samples [first, first + frame->nb_samples).
+ * */
+void fill_audio_frame (AVFrame *frame, int64_t first) {
+    for (int i = 0; i < frame->nb_samples; ++i) {
+        double value = 0.25 * sin(2.0 * M_PI * 440.0 * (first + i) / AUDIO_RATE);
+        for (int c = 0; c < frame->channels; ++c) {
+            if (frame->format == AV_SAMPLE_FMT_FLTP) {
+                ((float *) frame->data[c])[i] = (float) value;
+            } else {
+                ((int16_t *) frame->data[0])[i * frame->channels + c] = (int16_t) (value * 32767);
+            }
+        }
+    }
+}
+
+/**
+ * @def
+ * Send [frame] (nullptr flushes) and write the packets that come out.
+ * */
+bool encode (AVFormatContext *fmt_ctx, AVCodecContext *codec_ctx, AVStream *stream,
+    AVFrame *frame, AVPacket *packet) {
+    int res = avcodec_send_frame(codec_ctx, frame);
+    if (res < 0) {
+        fprintf(stderr, "Error: Failed to send frame to encoder.\n");
+        return false;
+    }
+
+    while (res >= 0) {
+        res = avcodec_receive_packet(codec_ctx, packet);
+        if (res == AVERROR(EAGAIN) || res == AVERROR_EOF) break;
+        if (res < 0) {
+            fprintf(stderr, "Error: Failed to encode frame.\n");
+            return false;
+        }
+
+        av_packet_rescale_ts(packet, codec_ctx->time_base, stream->time_base);
+        packet->stream_index = stream->index;
+        if (av_interleaved_write_frame(fmt_ctx, packet) < 0) {
+            fprintf(stderr, "Error: Failed to write packet.\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+AVCodecContext * open_video_encoder (const ClipSpec& spec, const AVCodec *codec,
+    AVFormatContext *fmt_ctx) {
+    AVCodecContext *ctx = avcodec_alloc_context3(codec);
+    if (ctx == nullptr) return nullptr;
+
+    ctx->width = spec.width;
+    ctx->height = spec.height;
+    ctx->pix_fmt = spec.pix_fmt;
+    ctx->gop_size = spec.gop_size;
+    ctx->max_b_frames = spec.max_b_frames;
+    ctx->bit_rate = (int64_t) spec.width * spec.height * 2;
+    // vfr clips count time in milliseconds
+    ctx->time_base = spec.vfr ? AVRational{1, 1000} : AVRational{1, spec.fps};
+    ctx->framerate = AVRational{spec.fps, 1};
+    ctx->flags |= AV_CODEC_FLAG_BITEXACT;
+    if (fmt_ctx->oformat->flags & AVFMT_GLOBALHEADER) {
+        ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+
+    AVDictionary *opts {nullptr};
+    // encoder threads make the output depend on the machine
+    av_dict_set(&opts, "threads", "1", 0);
+    if (strcmp(codec->name, "libx264") == 0 || strcmp(codec->name, "libx265") == 0) {
+        av_dict_set(&opts, "preset", "veryfast", 0);
+    }
+
+    int res = avcodec_open2(ctx, codec, &opts);
+    av_dict_free(&opts);
+    if (res < 0) {
+        avcodec_free_context(&ctx);
+        return nullptr;
+    }
+    return ctx;
+}
+
+AVCodecContext * open_audio_encoder (AVFormatContext *fmt_ctx) {
+    for (const char *name : AUDIO_ENCODERS) {
+        const AVCodec *codec = avcodec_find_encoder_by_name(name);
+        if (codec == nullptr) continue;
+
+        AVCodecContext *ctx = avcodec_alloc_context3(codec);
+        if (ctx == nullptr) continue;
+
+        ctx->sample_fmt = strcmp(name, "aac") == 0 ? AV_SAMPLE_FMT_FLTP : AV_SAMPLE_FMT_S16;
+        ctx->sample_rate = AUDIO_RATE;
+        ctx->channel_layout = AV_CH_LAYOUT_STEREO;
+        ctx->channels = 2;
+        ctx->bit_rate = 128000;
+        ctx->time_base = AVRational{1, AUDIO_RATE};
+        ctx->flags |= AV_CODEC_FLAG_BITEXACT;
+        if (fmt_ctx->oformat->flags & AVFMT_GLOBALHEADER) {
+            ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+        }
+
+        if (avcodec_open2(ctx, codec, nullptr) >= 0) return ctx;
+        avcodec_free_context(&ctx);
+    }
+    return nullptr;
+}
+
+bool generate_clip (const ClipSpec& spec, const std::string& dir) {
+    const std::string path = dir + "/" + spec.name + ".mkv";
+
+    const AVCodec *video_codec = find_video_encoder(spec.pix_fmt);
+    if (video_codec == nullptr) {
+        fprintf(stderr, "Error: No encoder for [%s], skipping.\n", spec.name);
+        return false;
+    }
+
+    AVFormatContext *fmt_ctx {nullptr};
+    if (avformat_alloc_output_context2(&fmt_ctx, nullptr, "matroska", path.c_str()) < 0) {
+        fprintf(stderr, "Error: Failed to create [%s].\n", path.c_str());
+        return false;
+    }
+    fmt_ctx->flags |= AVFMT_FLAG_BITEXACT;
+
+    bool ok {false};
+    AVCodecContext *video_ctx {nullptr}, *audio_ctx {nullptr};
+    AVStream *video_stream {nullptr}, *audio_stream {nullptr};
+    AVFrame *video_frame = av_frame_alloc();
+    AVFrame *audio_frame = av_frame_alloc();
+    AVPacket *packet = av_packet_alloc();
+
+    do {
+        if (video_frame == nullptr || audio_frame == nullptr || packet == nullptr) break;
+
+        video_ctx = open_video_encoder(spec, video_codec, fmt_ctx);
+        if (video_ctx == nullptr) {
+            fprintf(stderr, "Error: Failed to open encoder [%s].\n", video_codec->name);
+            break;
+        }
+        video_stream = avformat_new_stream(fmt_ctx, nullptr);
+        if (video_stream == nullptr
+            || avcodec_parameters_from_context(video_stream->codecpar, video_ctx) < 0) break;
+        video_stream->time_base = video_ctx->time_base;
+
+        if (spec.audio) {
+            audio_ctx = open_audio_encoder(fmt_ctx);
+            if (audio_ctx == nullptr) {
+                fprintf(stderr, "Error: No audio encoder available.\n");
+                break;
+            }
+            audio_stream = avformat_new_stream(fmt_ctx, nullptr);
+            if (audio_stream == nullptr
+                || avcodec_parameters_from_context(audio_stream->codecpar, audio_ctx) < 0) break;
+            audio_stream->time_base = audio_ctx->time_base;
+        }
+
+        if (avio_open(&fmt_ctx->pb, path.c_str(), AVIO_FLAG_WRITE) < 0) {
+            fprintf(stderr, "Error: Failed to open [%s] for writing.\n", path.c_str());
+            break;
+        }
+        if (avformat_write_header(fmt_ctx, nullptr) < 0) break;
+
+        video_frame->format = spec.pix_fmt;
+        video_frame->width = spec.width;
+        video_frame->height = spec.height;
+        if (av_frame_get_buffer(video_frame, 0) < 0) break;
+
+        if (audio_ctx != nullptr) {
+            audio_frame->format = audio_ctx->sample_fmt;
+            audio_frame->channel_layout = audio_ctx->channel_layout;
+            audio_frame->channels = audio_ctx->channels;
+            audio_frame->sample_rate = audio_ctx->sample_rate;
+            audio_frame->nb_samples = audio_ctx->frame_size > 0 ? audio_ctx->frame_size : 1024;
+            if (av_frame_get_buffer(audio_frame, 0) < 0) break;
+        }
+
+        bool failed {false};
+        int64_t pts {0}, audio_pts {0};
+        for (int i = 0; i < spec.frames && !failed; ++i) {
+            // audio up to the video frame's time
+            while (audio_ctx != nullptr && !failed
+                && av_compare_ts(audio_pts, audio_ctx->time_base, pts, video_ctx->time_base) <= 0) {
+                if (av_frame_make_writable(audio_frame) < 0) { failed = true; break; }
+                fill_audio_frame(audio_frame, audio_pts);
+                audio_frame->pts = audio_pts;
+                audio_pts += audio_frame->nb_samples;
+                failed = !encode(fmt_ctx, audio_ctx, audio_stream, audio_frame, packet);
+            }
+
+            if (av_frame_make_writable(video_frame) < 0) { failed = true; break; }
+            fill_video_frame(video_frame, i);
+            video_frame->pts = pts;
+            failed = failed || !encode(fmt_ctx, video_ctx, video_stream, video_frame, packet);
+
+            if (spec.vfr) {
+                const int n = sizeof(VFR_DURATIONS) / sizeof(VFR_DURATIONS[0]);
+                pts += VFR_DURATIONS[i % n] * 1000 / (2 * spec.fps);
+            } else {
+                ++pts;
+            }
+        }
+        if (failed) break;
+
+        if (!encode(fmt_ctx, video_ctx, video_stream, nullptr, packet)) break;
+        if (audio_ctx != nullptr && !encode(fmt_ctx, audio_ctx, audio_stream, nullptr, packet)) break;
+        if (av_write_trailer(fmt_ctx) < 0) break;
+
+        ok = true;
+    } while (false);
+
+    if (ok) {
+        printf("%s\t%dx%d %s %s gop %d%s%s\n", path.c_str(), spec.width, spec.height,
+            av_get_pix_fmt_name(spec.pix_fmt), video_codec->name, spec.gop_size,
+            spec.vfr ? " vfr" : "", spec.audio ? " +audio" : "");
+    } else {
+        fprintf(stderr, "Error: Failed to generate [%s].\n", path.c_str());
+    }
+
+    av_packet_free(&packet);
+    av_frame_free(&audio_frame);
+    av_frame_free(&video_frame);
+    if (audio_ctx != nullptr) avcodec_free_context(&audio_ctx);
+    if (video_ctx != nullptr) avcodec_free_context(&video_ctx);
+    if (fmt_ctx->pb != nullptr) avio_closep(&fmt_ctx->pb);
+    avformat_free_context(fmt_ctx);
+    return ok;
+}
+
+int main (int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <output_dir>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const std::string dir = argv[1];
+    mkdir(dir.c_str(), 0755);
+
+    int failed {0};
+    for (const auto& spec : CLIPS) {
+        if (!generate_clip(spec, dir)) ++failed;
+    }
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,337 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "../player/player.h"
+#include "../analysis/luma_kernels.h"
+#include "../window/window.h"
+
+/**
+ * Times the player's hot kernels in isolation on a clip (see
+ * gen_media): av_read_frame, decode, sws_scale, flip_img, the luma
+ * analysis kernels and, with --gl, texture upload and drawing.
+ * --tile N caps the texture size the window uploads in one piece, so
+ * the tiled upload path runs on GPUs that could take the whole frame.
+ *
+ * Every kernel runs once to warm up and then [reps] more times. The
+ * time per item (packet or frame) of each run is summarized as
+ * min/median/mean/stddev/max and printed as one JSON object per line
+ * on stdout. A readable table goes to stderr.
+ *
+ * Usage: kernel_bench [--reps N] [--gl] [--tile N] <clip>...
+ * */
+
+const size_t KEPT_FRAMES {16};
+
+struct Summary {
+    double min, median, mean, stddev, max;
+};
+
+Summary summarize (std::vector<double> samples) {
+    Summary s {0, 0, 0, 0, 0};
+    if (samples.empty()) return s;
+
+    std::sort(samples.begin(), samples.end());
+    const size_t n = samples.size();
+    s.min = samples.front();
+    s.max = samples.back();
+    s.median = n % 2 ? samples[n/2] : (samples[n/2 - 1] + samples[n/2]) / 2;
+
+    for (double v : samples) s.mean += v;
+    s.mean /= n;
+    for (double v : samples) s.stddev += (v - s.mean) * (v - s.mean);
+    s.stddev = n > 1 ? sqrt(s.stddev / (n - 1)) : 0.0;
+    return s;
+}
+
+void report (const std::string& clip, const char *kernel, const char *unit,
+    size_t items, const std::vector<double>& samples) {
+    Summary s = summarize(samples);
+    printf("{\"clip\":\"%s\",\"kernel\":\"%s\",\"unit\":\"%s\",\"items\":%zu,\"reps\":%zu,"
+        "\"min\":%.1f,\"median\":%.1f,\"mean\":%.1f,\"stddev\":%.1f,\"max\":%.1f}\n",
+        clip.c_str(), kernel, unit, items, samples.size(),
+        s.min, s.median, s.mean, s.stddev, s.max);
+    fprintf(stderr, "  %-16s %12.1f %s (median, +/- %.1f, %zu items x %zu reps)\n",
+        kernel, s.median, unit, s.stddev, items, samples.size());
+    fflush(stdout);
+}
+
+/**
+ * @def
+ * Run [fn] once to warm up, then [reps] times, and return the time of
+ * each run divided by [items] in nanoseconds.
+ * */
+template <typename F>
+std::vector<double> measure (int reps, size_t items, F fn) {
+    std::vector<double> samples;
+    fn();
+    for (int r = 0; r < reps; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        std::chrono::duration<double, std::nano> elapsed =
+            std::chrono::steady_clock::now() - start;
+        samples.push_back(elapsed.count() / (items > 0 ? items : 1));
+    }
+    return samples;
+}
+
+struct Clip {
+    AVFormatContext *fmt_ctx = nullptr;
+    AVCodecContext *codec_ctx = nullptr;
+    int stream_index = -1;
+};
+
+bool open_clip (const std::string& path, Clip& clip, bool open_decoder) {
+    if (avformat_open_input(&clip.fmt_ctx, path.c_str(), nullptr, nullptr) != 0) {
+        fprintf(stderr, "Error: Failed to open [%s].\n", path.c_str());
+        return false;
+    }
+    if (avformat_find_stream_info(clip.fmt_ctx, nullptr) < 0) return false;
+
+    clip.stream_index = av_find_best_stream(clip.fmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (clip.stream_index < 0) {
+        fprintf(stderr, "Error: No video stream in [%s].\n", path.c_str());
+        return false;
+    }
+    if (!open_decoder) return true;
+
+    AVCodecParameters *params = clip.fmt_ctx->streams[clip.stream_index]->codecpar;
+    const AVCodec *codec = avcodec_find_decoder(params->codec_id);
+    if (codec == nullptr) return false;
+
+    clip.codec_ctx = avcodec_alloc_context3(codec);
+    if (clip.codec_ctx == nullptr
+        || avcodec_parameters_to_context(clip.codec_ctx, params) < 0
+        || avcodec_open2(clip.codec_ctx, codec, nullptr) < 0) {
+        fprintf(stderr, "Error: Failed to open decoder for [%s].\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+void close_clip (Clip& clip) {
+    if (clip.codec_ctx != nullptr) avcodec_free_context(&clip.codec_ctx);
+    if (clip.fmt_ctx != nullptr) avformat_close_input(&clip.fmt_ctx);
+}
+
+void bench_clip (const std::string& path, int reps, bool gl, int tile) {
+    fprintf(stderr, "%s (luma kernels: %s)\n", path.c_str(), luma_kernels_isa());
+
+    // demuxing: the file is reopened for every run so every run
+    // parses the container from the start
+    size_t packets {0};
+    {
+        Clip clip;
+        if (!open_clip(path, clip, false)) { close_clip(clip); return; }
+        AVPacket *packet = av_packet_alloc();
+        while (av_read_frame(clip.fmt_ctx, packet) >= 0) {
+            ++packets;
+            av_packet_unref(packet);
+        }
+        av_packet_free(&packet);
+        close_clip(clip);
+    }
+
+    std::vector<double> read_samples;
+    for (int r = 0; r <= reps; ++r) {
+        Clip clip;
+        if (!open_clip(path, clip, false)) { close_clip(clip); return; }
+        AVPacket *packet = av_packet_alloc();
+
+        auto start = std::chrono::steady_clock::now();
+        while (av_read_frame(clip.fmt_ctx, packet) >= 0) av_packet_unref(packet);
+        std::chrono::duration<double, std::nano> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        // run 0 is the warm up
+        if (r > 0) read_samples.push_back(elapsed.count() / packets);
+        av_packet_free(&packet);
+        close_clip(clip);
+    }
+    report(path, "av_read_frame", "ns/packet", packets, read_samples);
+
+    // decoding from packets held in memory
+    Clip clip;
+    if (!open_clip(path, clip, true)) { close_clip(clip); return; }
+
+    std::vector<AVPacket *> video_packets;
+    {
+        AVPacket *packet = av_packet_alloc();
+        while (av_read_frame(clip.fmt_ctx, packet) >= 0) {
+            if (packet->stream_index == clip.stream_index) {
+                video_packets.push_back(av_packet_clone(packet));
+            }
+            av_packet_unref(packet);
+        }
+        av_packet_free(&packet);
+    }
+
+    AVFrame *frame = av_frame_alloc();
+    std::vector<AVFrame *> kept;
+    size_t decoded {0};
+    auto decode_all = [&] () {
+        decoded = 0;
+        avcodec_flush_buffers(clip.codec_ctx);
+        for (size_t i = 0; i <= video_packets.size(); ++i) {
+            // the last send drains the decoder
+            int res = avcodec_send_packet(clip.codec_ctx,
+                i < video_packets.size() ? video_packets[i] : nullptr);
+            while (res >= 0) {
+                res = avcodec_receive_frame(clip.codec_ctx, frame);
+                if (res < 0) break;
+                if (kept.size() < KEPT_FRAMES) kept.push_back(av_frame_clone(frame));
+                ++decoded;
+            }
+        }
+    };
+    decode_all();
+    report(path, "decode", "ns/frame", decoded, measure(reps, decoded, decode_all));
+
+    if (kept.empty()) {
+        fprintf(stderr, "Error: Nothing decoded from [%s].\n", path.c_str());
+    } else {
+        const int width {kept[0]->width};
+        const int height {kept[0]->height};
+        const AVPixelFormat src_format = (AVPixelFormat) kept[0]->format;
+        auto desc = av_pix_fmt_desc_get(src_format);
+        const bool deep = desc != nullptr && desc->comp[0].depth > 8;
+        const AVPixelFormat out_format = deep ? AV_PIX_FMT_RGB48 : AV_PIX_FMT_RGB24;
+
+        // the player's conversion, same flags and output formats
+        SwsContext *sws_ctx = sws_getContext(width, height, src_format,
+            width, height, out_format, SWS_BILINEAR, nullptr, nullptr, nullptr);
+        uint8_t *rgb[4] = {nullptr};
+        int rgb_linesize[4];
+        if (sws_ctx != nullptr
+            && av_image_alloc(rgb, rgb_linesize, width, height, out_format, 1) >= 0) {
+            report(path, "sws_scale", "ns/frame", kept.size(),
+                measure(reps, kept.size(), [&] () {
+                    for (auto *f : kept) {
+                        sws_scale(sws_ctx, f->data, f->linesize, 0, height, rgb, rgb_linesize);
+                    }
+                }));
+
+            if (!deep) {
+                report(path, "flip_img", "ns/frame", KEPT_FRAMES,
+                    measure(reps, KEPT_FRAMES, [&] () {
+                        for (size_t i = 0; i < KEPT_FRAMES; ++i) flip_img(rgb[0], width, height);
+                    }));
+            }
+
+            if (gl) {
+                window win;
+                win.init(width, height);
+                if (win.ok()) {
+                    const int bytes_per_channel = deep ? 2 : 1;
+                    if (tile > 0) win.set_max_tile_size(tile);
+                    // don't let vsync pace the draws
+                    glfwSwapInterval(0);
+
+                    // the tiles are built on the first upload
+                    win.upload_image(rgb[0], width, height, bytes_per_channel);
+                    fprintf(stderr, "  %zu texture tile(s) of at most %dx%d\n",
+                        win.tile_count(), win.max_tile_size(), win.max_tile_size());
+                    const std::string suffix = tile > 0 ? "_tile" + std::to_string(tile) : "";
+
+                    report(path, ("texture_upload" + suffix).c_str(), "ns/frame", KEPT_FRAMES,
+                        measure(reps, KEPT_FRAMES, [&] () {
+                            for (size_t i = 0; i < KEPT_FRAMES; ++i) {
+                                win.upload_image(rgb[0], width, height, bytes_per_channel);
+                            }
+                            // wait for the uploads, not just their submission
+                            glFinish();
+                        }));
+
+                    // upload plus one quad per tile and the buffer swap
+                    report(path, ("draw_image" + suffix).c_str(), "ns/frame", KEPT_FRAMES,
+                        measure(reps, KEPT_FRAMES, [&] () {
+                            for (size_t i = 0; i < KEPT_FRAMES; ++i) {
+                                win.draw_image(rgb[0], width, height, bytes_per_channel);
+                            }
+                            glFinish();
+                        }));
+                } else {
+                    fprintf(stderr, "Error: No GL window, skipping texture upload.\n");
+                }
+            }
+        }
+        av_freep(&rgb[0]);
+        sws_freeContext(sws_ctx);
+
+        if (!deep && desc != nullptr && (desc->flags & AV_PIX_FMT_FLAG_RGB) == 0) {
+            uint32_t hist[256];
+            report(path, "luma_histogram", "ns/frame", kept.size(),
+                measure(reps, kept.size(), [&] () {
+                    for (auto *f : kept) luma_histogram(f->data[0], f->linesize[0], width, height, hist);
+                }));
+
+            volatile uint64_t sad {0};
+            report(path, "luma_sad", "ns/frame", kept.size() - 1,
+                measure(reps, kept.size() - 1, [&] () {
+                    for (size_t i = 1; i < kept.size(); ++i) {
+                        sad = sad + luma_sad(kept[i]->data[0], kept[i]->linesize[0],
+                            kept[i-1]->data[0], kept[i-1]->linesize[0], width, height);
+                    }
+                }));
+        } else if (deep && desc != nullptr && (desc->flags & AV_PIX_FMT_FLAG_RGB) == 0
+            && (desc->flags & AV_PIX_FMT_FLAG_BE) == 0) {
+            const int bits = desc->comp[0].depth + desc->comp[0].shift;
+            uint32_t hist[256];
+            report(path, "luma_histogram16", "ns/frame", kept.size(),
+                measure(reps, kept.size(), [&] () {
+                    for (auto *f : kept) {
+                        luma_histogram16((const uint16_t *) f->data[0], f->linesize[0],
+                            width, height, bits, hist);
+                    }
+                }));
+
+            volatile uint64_t sad {0};
+            report(path, "luma_sad16", "ns/frame", kept.size() - 1,
+                measure(reps, kept.size() - 1, [&] () {
+                    for (size_t i = 1; i < kept.size(); ++i) {
+                        sad = sad + luma_sad16((const uint16_t *) kept[i]->data[0], kept[i]->linesize[0],
+                            (const uint16_t *) kept[i-1]->data[0], kept[i-1]->linesize[0],
+                            width, height);
+                    }
+                }));
+        }
+    }
+
+    for (auto *f : kept) av_frame_free(&f);
+    for (auto *p : video_packets) av_packet_free(&p);
+    av_frame_free(&frame);
+    close_clip(clip);
+}
+
+int main (int argc, char **argv) {
+    int reps {10};
+    bool gl {false};
+    int tile {0};
+    std::vector<std::string> clips;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--gl") == 0) {
+            gl = true;
+        } else if (strcmp(argv[i], "--tile") == 0 && i + 1 < argc) {
+            tile = atoi(argv[++i]);
+            gl = true;
+        } else {
+            clips.push_back(argv[i]);
+        }
+    }
+
+    if (clips.empty() || reps <= 0 || tile < 0) {
+        fprintf(stderr, "Usage: %s [--reps N] [--gl] [--tile N] <clip>...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    for (const auto& clip : clips) bench_clip(clip, reps, gl, tile);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cinttypes>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "../sink/shm_sink.h"
+
+/**
+ * Throughput benchmark for the shared-memory frame export.
+ * One writer publishes RGB frames as fast as it can while [readers]
+ * threads, each with their own mapping, read every frame in place.
+ *
+ * Usage: shm_bench [width] [height] [frames] [readers] [slots]
+ * */
+
+struct ReaderStats {
+    uint64_t read = 0;
+    uint64_t skipped = 0;
+    uint64_t torn = 0;
+};
+
+void read_frames (const std::string& name, std::atomic<bool>& done,
+    ReaderStats& stats) {
+    ShmFrameReader reader;
+    if (!reader.open(name)) return;
+
+    ShmFrameView view;
+    volatile uint32_t sink {0};
+    while (true) {
+        SHM_READ_RESULT res = reader.next(view, 100);
+        if (res == SHM_READ_CLOSED) break;
+        if (res == SHM_READ_TIMEOUT) {
+            if (done) break;
+            continue;
+        }
+
+        // touch one byte per cache line, like a consumer scanning the frame
+        uint32_t sum {0};
+        for (uint32_t i = 0; i < view.data_size; i += 64) sum += view.data[0][i];
+        sink = sink + sum;
+
+        if (!reader.still_valid(view)) ++stats.torn;
+    }
+
+    stats.read = reader.frames_read();
+    stats.skipped = reader.frames_skipped();
+}
+
+int main (int argc, char **argv) {
+    const int width = argc > 1 ? atoi(argv[1]) : 1920;
+    const int height = argc > 2 ? atoi(argv[2]) : 1080;
+    const int frames = argc > 3 ? atoi(argv[3]) : 2000;
+    const int readers = argc > 4 ? atoi(argv[4]) : 2;
+    const int slots = argc > 5 ? atoi(argv[5]) : 8;
+
+    const std::string name = "/vp-bench-" + std::to_string(getpid());
+
+    ShmFrameSink sink;
+    if (!sink.open(name, slots, width, height, AV_PIX_FMT_RGB24)) {
+        return EXIT_FAILURE;
+    }
+
+    std::atomic<bool> done {false};
+    std::vector<ReaderStats> stats(readers);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < readers; ++i) {
+        threads.emplace_back(read_frames, name, std::ref(done), std::ref(stats[i]));
+    }
+    // let the readers map the ring before the first frame
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    const size_t frame_size = (size_t) width * height * 3;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; ++i) {
+        uint8_t *data[4];
+        int linesize[4];
+        sink.begin_frame(data, linesize);
+        memset(data[0], i & 0xff, frame_size);
+        sink.commit_frame(i, AVRational{1, 30});
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    // readers drain what is left and stop on the close
+    sink.close();
+    done = true;
+    for (auto& t : threads) t.join();
+
+    const double secs = elapsed.count();
+    printf("Export: %dx%d rgb24, %d slots, %d frames in %.3f s\n",
+        width, height, slots, frames, secs);
+    printf("\twriter:\t%.1f frames/s\t%.1f MB/s\n",
+        frames / secs, frames * frame_size / secs / (1024.0 * 1024.0));
+    for (int i = 0; i < readers; ++i) {
+        printf("\treader %d:\tread %" PRIu64 "\tskipped %" PRIu64 "\ttorn %" PRIu64 "\n",
+            i, stats[i].read, stats[i].skipped, stats[i].torn);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,64 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cinttypes>
+#include <unistd.h>
+
+#include "../sink/shm_ring.h"
+
+/**
+ * Reference reader for the player's shared-memory frame export.
+ * Maps the ring, prints every frame it gets and a checksum of its
+ * first plane, read in place from the shared mapping. Follows the
+ * player to its next ring when it closes the current one.
+ *
+ * Usage: shm_reader <name> [frames]
+ * */
+
+int main (int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <name> [frames]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const long frames = argc > 2 ? atol(argv[2]) : -1;
+
+    ShmFrameReader reader;
+    if (!reader.open(argv[1])) return EXIT_FAILURE;
+
+    ShmFrameView view;
+    long count {0};
+    while (frames < 0 || count < frames) {
+        SHM_READ_RESULT res = reader.next(view, 1000);
+        if (res == SHM_READ_TIMEOUT) {
+            printf("Waiting for frames...\n");
+            continue;
+        }
+        if (res == SHM_READ_CLOSED) {
+            printf("Writer closed the ring, reopening...\n");
+            reader.close();
+            while (!reader.open(argv[1])) sleep(1);
+            continue;
+        }
+
+        uint32_t checksum {0};
+        for (int y = 0; y < view.height; ++y) {
+            const uint8_t *row = view.data[0] + (size_t) y * view.linesize[0];
+            for (int x = 0; x < view.linesize[0]; ++x) checksum += row[x];
+        }
+
+        // the writer may have lapped us while we summed
+        if (!reader.still_valid(view)) {
+            printf("Frame %" PRIu64 " overwritten while reading, skipped.\n", view.number);
+            continue;
+        }
+
+        printf("Frame %" PRIu64 "\tpts %" PRId64 " (%d/%d)\t%dx%d fmt %d\tsum %08x\n",
+            view.number, view.pts, view.time_base_num, view.time_base_den,
+            view.width, view.height, view.format, checksum);
+        ++count;
+    }
+
+    printf("Read %" PRIu64 " frames, skipped %" PRIu64 ".\n",
+        reader.frames_read(), reader.frames_skipped());
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,25 @@
+#ifndef _UTIL_H_
+#define _UTIL_H_
+
+#include <cstdio>
+#include <unistd.h>
+
+/**
+ * @def
+ * Resident set size of this process in kilobytes, read from
+ * /proc/self/statm.
+ * @returns -1 if it could not be read.
+ * */
+inline long current_rss_kb () {
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f == nullptr) return -1;
+
+    long size {0}, resident {0};
+    int n = fscanf(f, "%ld %ld", &size, &resident);
+    fclose(f);
+    if (n != 2) return -1;
+
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+#endif
@@ -2,6 +2,11 @@
 
 window::~window() {
     if (status == WINDOW_STATUS::OK) {
+        make_current();
+        delete_tiles();
+        glDeleteBuffers(1, &vbo_);
+        glDeleteVertexArrays(1, &vao_);
+        glDeleteProgram(shader_id_);
         glfwTerminate();
     }
 }
@@ -21,7 +26,20 @@ void window::init(int width, int height) {
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-    gl_window_ = glfwCreateWindow(width, height, "Video Player", nullptr, nullptr);
+    // large videos get a window that fits the screen, the
+    // image is scaled down to it when drawn
+    int win_width {width}, win_height {height};
+    GLFWmonitor *monitor = glfwGetPrimaryMonitor();
+    const GLFWvidmode *mode = monitor == nullptr ? nullptr : glfwGetVideoMode(monitor);
+    if (mode != nullptr && (width > mode->width || height > mode->height)) {
+        const float scale_w = (float) mode->width / width;
+        const float scale_h = (float) mode->height / height;
+        const float scale = (scale_w < scale_h ? scale_w : scale_h) * 0.9f;
+        win_width = (int) (width * scale);
+        win_height = (int) (height * scale);
+    }
+
+    gl_window_ = glfwCreateWindow(win_width, win_height, "Video Player", nullptr, nullptr);
     if (!gl_window_) {
         glfwTerminate();
         status = WINDOW_STATUS::FAILED_INITIALIZATION;
@@ -37,6 +55,12 @@ void window::init(int width, int height) {
     }
     glfwSetInputMode(gl_window_, GLFW_STICKY_KEYS, GL_TRUE);
 
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size_);
+    if (max_texture_size_ <= 0) max_texture_size_ = 2048;
+    if (max_tile_size_ <= 0 || max_tile_size_ > max_texture_size_) {
+        max_tile_size_ = max_texture_size_;
+    }
+
     const char *vertex_shader = 
     R"vert_shader(
         #version 330 core
@@ -94,18 +118,8 @@ void window::init(int width, int height) {
     glEnableVertexAttribArray(img_location_);
     glVertexAttribPointer(img_location_, 2, GL_FLOAT, GL_FALSE, 5*sizeof(float), (void*)(3*sizeof(float)));
 
-    // generate random image
-    std::vector<uint8_t> img;
-    uint8_t byte_info;
-    const float den = RAND_MAX == 0? 1.0f : RAND_MAX * 1.0f;
-    for (int i = 0; i < width_ * height_ * 3; ++i) {
-        byte_info = (uint8_t) (((rand() * 1.0f)/den) * 255);
-        img.push_back(byte_info);
-    }
     status = WINDOW_STATUS::OK;
 
-    // draw_image(&img[0], width_, height_);
-
     /*
     GLuint image = window::generate_random_img(100, 100);
 
@@ -129,44 +143,145 @@ void window::init(int width, int height) {
     glfwPollEvents();
 }
 
-void window::draw_image(const uint8_t *img_buffer, int width, int height) {
+void window::draw_image(const uint8_t *img_buffer, int width, int height,
+    int bytes_per_channel) {
     if (status != WINDOW_STATUS::OK) {
         fprintf(stderr, "Error: Window not initialized.\n");
         return;
     }
 
-    glClear(GL_COLOR_BUFFER_BIT);
-
-    GLuint tex;
-    glGenTextures(1, &tex);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, tex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB,
-        GL_UNSIGNED_BYTE, (const GLvoid *) img_buffer);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, tex);
-    glUniform1i(glGetUniformLocation(shader_id_, "tex_sampler"), 0);
+    upload_image(img_buffer, width, height, bytes_per_channel);
 
     glClear(GL_COLOR_BUFFER_BIT);
     glUseProgram(shader_id_);
+    glUniform1i(glGetUniformLocation(shader_id_, "tex_sampler"), 0);
     glBindVertexArray(vao_);
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, tex);
     glEnableVertexAttribArray(pos_location_);
     glEnableVertexAttribArray(img_location_);
     glBindBuffer(GL_ARRAY_BUFFER, vbo_);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    for (size_t i = 0; i < tiles_.size(); ++i) {
+        glBindTexture(GL_TEXTURE_2D, tiles_[i].tex);
+        glDrawArrays(GL_TRIANGLES, i * 6, 6);
+    }
     glDisableVertexAttribArray(0);
 
     glfwSwapBuffers(gl_window_);
     glfwPollEvents();
 }
 
+void window::upload_image(const uint8_t *img_buffer, int width, int height,
+    int bytes_per_channel) {
+    if (status != WINDOW_STATUS::OK) {
+        fprintf(stderr, "Error: Window not initialized.\n");
+        return;
+    }
+
+    if (width != tex_width_ || height != tex_height_
+        || bytes_per_channel != tex_bytes_per_channel_) {
+        build_tiles(width, height, bytes_per_channel);
+    }
+
+    const GLenum type = bytes_per_channel == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE;
+
+    // every tile reads its rectangle straight out of the full image
+    glActiveTexture(GL_TEXTURE0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+    for (const auto& tile : tiles_) {
+        glBindTexture(GL_TEXTURE_2D, tile.tex);
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, tile.x);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, tile.y);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tile.width, tile.height, GL_RGB,
+            type, (const GLvoid *) img_buffer);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+}
+
+void window::set_max_tile_size(int size) {
+    max_tile_size_ = size;
+    if (max_texture_size_ > 0 && (max_tile_size_ <= 0 || max_tile_size_ > max_texture_size_)) {
+        max_tile_size_ = max_texture_size_;
+    }
+    // rebuild on the next draw
+    tex_width_ = tex_height_ = 0;
+}
+
+void window::build_tiles(int width, int height, int bytes_per_channel) {
+    delete_tiles();
+
+    const int tile_size = max_tile_size_;
+    const GLenum internal_format = bytes_per_channel == 2 ? GL_RGB16 : GL_RGB8;
+    const GLenum type = bytes_per_channel == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE;
+    std::vector<GLfloat> vertices;
+
+    for (int y = 0; y < height; y += tile_size) {
+        for (int x = 0; x < width; x += tile_size) {
+            Tile tile;
+            tile.x = x;
+            tile.y = y;
+            tile.width = width - x < tile_size ? width - x : tile_size;
+            tile.height = height - y < tile_size ? height - y : tile_size;
+
+            glGenTextures(1, &tile.tex);
+            glBindTexture(GL_TEXTURE_2D, tile.tex);
+            glTexImage2D(GL_TEXTURE_2D, 0, internal_format, tile.width, tile.height, 0,
+                GL_RGB, type, nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            tiles_.push_back(tile);
+
+            // the tile's share of the screen, image row 0 at the top
+            const GLfloat left = -1.0f + 2.0f * x / width;
+            const GLfloat right = -1.0f + 2.0f * (x + tile.width) / width;
+            const GLfloat top = 1.0f - 2.0f * y / height;
+            const GLfloat bottom = 1.0f - 2.0f * (y + tile.height) / height;
+            const GLfloat quad[] = {
+                left,   bottom, 0.0f,       0.0f,   1.0f,
+                right,  bottom, 0.0f,       1.0f,   1.0f,
+                right,  top,    0.0f,       1.0f,   0.0f,
+                right,  top,    0.0f,       1.0f,   0.0f,
+                left,   top,    0.0f,       0.0f,   0.0f,
+                left,   bottom, 0.0f,       0.0f,   1.0f
+            };
+            vertices.insert(vertices.end(), quad, quad + 30);
+        }
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat),
+        vertices.data(), GL_STATIC_DRAW);
+
+    tex_width_ = width;
+    tex_height_ = height;
+    tex_bytes_per_channel_ = bytes_per_channel;
+
+    if (tiles_.size() > 1) {
+        printf("Drawing %dx%d frames as %zu tiles of up to %dx%d.\n",
+            width, height, tiles_.size(), tile_size, tile_size);
+    }
+}
+
+void window::delete_tiles() {
+    for (auto& tile : tiles_) glDeleteTextures(1, &tile.tex);
+    tiles_.clear();
+    tex_width_ = tex_height_ = tex_bytes_per_channel_ = 0;
+}
+
+void window::make_current() {
+    if (gl_window_ != nullptr) {
+        glfwMakeContextCurrent(gl_window_);
+    }
+}
+
+void window::release_current() {
+    glfwMakeContextCurrent(nullptr);
+}
+
 GLuint window::generate_random_img(int width, int height) {
     std::vector<float> img_buff;
 
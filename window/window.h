@@ -34,13 +34,66 @@ public:
      * respectively for one pixel).
      * @param width The width of the image represented by the image buffer
      * @param height The height of the image represented by the image buffer
+     * @param bytes_per_channel 1 for 8-bit channels, 2 for 16-bit channels
+     * in native byte order (RGB48), which are uploaded without truncation.
      * */
-    void draw_image(const uint8_t *img_buffer, int width, int height);
+    void draw_image(const uint8_t *img_buffer, int width, int height,
+        int bytes_per_channel = 1);
+
+    /**
+     * @def
+     * Upload the image into the window's textures without drawing it.
+     * Takes the same parameters as draw_image.
+     * */
+    void upload_image(const uint8_t *img_buffer, int width, int height,
+        int bytes_per_channel = 1);
+
+    /**
+     * @def
+     * Largest texture the window uploads in one piece. Images wider or
+     * taller than this are split into tiles. Can't be raised above the
+     * GL implementation's GL_MAX_TEXTURE_SIZE.
+     * */
+    void set_max_tile_size(int size);
+    int max_tile_size() const { return max_tile_size_; }
+    size_t tile_count() const { return tiles_.size(); }
+
+    /**
+     * @def
+     * Make the window's GL context current on / release it from the
+     * calling thread, so a window can be handed from one playback
+     * thread to the next.
+     * */
+    void make_current();
+    void release_current();
+
+    bool ok() const { return status == WINDOW_STATUS::OK; }
+    uint width() const { return width_; }
+    uint height() const { return height_; }
 
 private:
-    GLFWwindow *gl_window_;
-    WINDOW_STATUS status;
+    GLFWwindow *gl_window_ = nullptr;
+    WINDOW_STATUS status = WINDOW_STATUS::FAILED_INITIALIZATION;
     GLuint shader_id_;
+    /**
+     * @def
+     * Part of the image at pixel ([x], [y]) uploaded into its own
+     * texture.
+     * */
+    struct Tile {
+        GLuint tex;
+        int x, y;
+        int width, height;
+    };
+    /**
+     * @def
+     * Textures the frames are uploaded into. They are created on the
+     * first draw and only rebuilt when the image size or depth changes.
+     * */
+    std::vector<Tile> tiles_;
+    int tex_width_ = 0, tex_height_ = 0, tex_bytes_per_channel_ = 0;
+    GLint max_texture_size_ = 0;
+    int max_tile_size_ = 0;
     GLuint vao_, vbo_,
         pos_location_,
         img_location_;
@@ -54,6 +107,14 @@ private:
      *  If an error occurs, then an error value is returned.
      * */
     static GLuint load_shaders(const char *vert_shader, const char *frag_shader);
+
+    /**
+     * @def
+     * Create the tile textures and the quads they are drawn on for
+     * a [width]x[height] image.
+     * */
+    void build_tiles(int width, int height, int bytes_per_channel);
+    void delete_tiles();
     static GLuint generate_random_img(int width, int height);
 };
 